@@ -7,20 +7,41 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <algorithm>
+#include <random>
 
 #include "algo.h"
+#include "elements.h"
+#include "recording.h"
+#include "cachesim.h"
+#include "scheduler.h"
 
 using namespace std;
 
-extern vector<algo::TraceableAtom<int>> target;
-extern bool running;
-
 namespace algo {
-  class BubbleSort : public IAlgo {
+  // Straight insertion of [begin, end), shared by Insertion Sort and the
+  // small subranges of the recursive sorts. Stops between elements once
+  // the token, if any, is cancelled.
+  template <typename Range> static void insertion_sort(Range& target, size_t begin, size_t end, const CancellationToken* token = nullptr){
+    for(size_t i = begin+1; i < end && !(token && token->cancelled()); i++){
+      typename Range::value_type val = target[i];
+      size_t j = i;
+      while(j > begin && target[j-1] > val){
+        target[j] = target[j-1];
+        j--;
+      }
+      target[j] = val;
+    }
+  }
+
+  template <typename Target> class BubbleSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       bool swapped = true;
-      while(swapped){
+      while(swapped && !token.cancelled()){
         swapped = false;
         for(size_t i = 1; i < target.size(); i++){
           if(target[i-1] > target[i]){
@@ -32,11 +53,14 @@ namespace algo {
     }
   };
 
-  class CocktailShakerSort : public IAlgo {
+  template <typename Target> class CocktailShakerSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       bool swapped = true;
-      while(swapped){
+      while(swapped && !token.cancelled()){
         { // forwards
           swapped = false;
           for(size_t i = 1; i < target.size(); i++){
@@ -51,9 +75,9 @@ namespace algo {
 
         { // backwards
           swapped = false;
-          for(size_t i = target.size()-2; i > 0; i--){
-            if(target[i] > target[i+1]){
-              swap(target[i], target[i+1]);
+          for(size_t i = target.size()-1; i > 0; i--){
+            if(target[i-1] > target[i]){
+              swap(target[i-1], target[i]);
               swapped = true;
             }
           }
@@ -62,11 +86,14 @@ namespace algo {
     }
   };
 
-  class SelectionSort : public IAlgo {
+  template <typename Target> class SelectionSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       size_t size = target.size();
-      for(size_t current = 0; current < size; current++){
+      for(size_t current = 0; current < size && !token.cancelled(); current++){
         size_t minimum = current;
         for(size_t candidate = current+1; candidate < size; candidate++){
           if(target[candidate] < target[minimum]){
@@ -80,45 +107,44 @@ namespace algo {
     }
   };
 
-  class MonkeySort : public IAlgo {
+  template <typename Target> class MonkeySort : public IAlgo<Target> {
   private:
-    bool isSorted() {
+    using Range = TracedRange<Target>;
+
+    bool isSorted(Range& target) {
       size_t size = target.size();
-      for (size_t i = 0; i < size-1; i++) {
-        if (target[i] > target[i+1]) return false;
+      for (size_t i = 1; i < size; i++) {
+        if (target[i-1] > target[i]) return false;
       }
       return true;
     }
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       size_t size = target.size();
-      std::srand(std::time(nullptr));
-      while(!isSorted()) {
-        int idx1 = rand() % size;
-        int idx2 = rand() % size;
+      // rand() is shared by every thread, each run shuffles with its own
+      minstd_rand rng(std::time(nullptr));
+      while(!token.cancelled() && !isSorted(target)) {
+        int idx1 = rng() % size;
+        int idx2 = rng() % size;
         swap(target[idx1], target[idx2]);
       }
     }
   };
 
-  class InsertionSort : public IAlgo {
+  template <typename Target> class InsertionSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
-      size_t size = target.size();
-      for(size_t i = 1; i < size; i++) {
-        int val = target[i];
-        int j = i;
-        while(j > 0 && target[j-1] > val) {
-          target[j] = target[j-1];
-          j--;
-        }
-        target[j] = val;
-      }
+    void run(Range target, const CancellationToken& token){
+      insertion_sort(target, 0, target.size(), &token);
     }
   };
-  class HeapSort : public IAlgo {
+  template <typename Target> class HeapSort : public IAlgo<Target> {
   private:
-    void siftDown(size_t start, size_t end){
+    using Range = TracedRange<Target>;
+
+    void siftDown(Range& target, size_t start, size_t end){
       size_t& root = start;
       while (2*root+1 <= end){
         size_t child = 2*root+1;
@@ -138,29 +164,33 @@ namespace algo {
       }
     };
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       size_t size = target.size();
+      if(size < 2) return;
       ssize_t start = (size-2)/2;
-      while (start >= 0) {
-        siftDown(start, size-1);
+      while (start >= 0 && !token.cancelled()) {
+        siftDown(target, start, size-1);
         start--;
       }
       size_t end = size - 1;
-      while (end > 0){
+      while (end > 0 && !token.cancelled()){
         swap(target[end], target[0]);
         end--;
-        siftDown(0,end);
+        siftDown(target, 0,end);
       }
     }
   };
 
-class CombSort : public IAlgo {
+template <typename Target> class CombSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       size_t gap = target.size();
       float shrink = 1.3;
       bool sorted = false;
-      while(!sorted) {
+      while(!sorted && !token.cancelled()) {
         gap /= shrink;
         if (gap <= 1) {
           gap = 1;
@@ -180,12 +210,18 @@ class CombSort : public IAlgo {
 
   };
 
-  class GnomeSort : public IAlgo{
+  template <typename Target> class GnomeSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+
   public:
-    void run(){
+    void run(Range target, const CancellationToken& token){
       size_t i = 0;
       size_t size = target.size();
+      if(size < 2) return;
+      size_t steps = 0;
       while(i < size){
+        if (++steps % 4096 == 0 && token.cancelled()) return;
         if (i == 0){
           i++;
         }
@@ -200,34 +236,1062 @@ class CombSort : public IAlgo {
       return;
     }
   };
+
+  // Pattern-defeating quicksort (Orson Peters): insertion sort below a
+  // cutoff, median-of-3 or ninther pivots, branchless block partitioning and
+  // a heapsort fallback once too many partitions came out unbalanced
+  template <typename Target> class PdqSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+
+    static const size_t insertion_sort_threshold = 24;
+    static const size_t ninther_threshold = 128;
+    static const size_t partial_insertion_sort_limit = 8;
+    static const size_t block_size = 64;
+
+    // unguarded relies on the element before begin being <= everything
+    void insertionSort(Range& target, size_t begin, size_t end, bool unguarded){
+      if(begin == end) return;
+      for(size_t cur = begin+1; cur < end; cur++){
+        size_t sift = cur;
+        if(target[sift] < target[sift-1]){
+          T tmp = target[sift];
+          do{
+            target[sift] = target[sift-1];
+            sift--;
+          }while((unguarded || sift != begin) && tmp < target[sift-1]);
+          target[sift] = tmp;
+        }
+      }
+    }
+
+    // gives up once more than a few elements had to move
+    bool partialInsertionSort(Range& target, size_t begin, size_t end){
+      if(begin == end) return true;
+      size_t limit = 0;
+      for(size_t cur = begin+1; cur < end; cur++){
+        size_t sift = cur;
+        if(target[sift] < target[sift-1]){
+          T tmp = target[sift];
+          do{
+            target[sift] = target[sift-1];
+            sift--;
+          }while(sift != begin && tmp < target[sift-1]);
+          target[sift] = tmp;
+          limit += cur - sift;
+        }
+        if(limit > partial_insertion_sort_limit) return false;
+      }
+      return true;
+    }
+
+    void sort2(Range& target, size_t a, size_t b){
+      if(target[b] < target[a]) swap(target[a], target[b]);
+    }
+
+    void sort3(Range& target, size_t a, size_t b, size_t c){
+      sort2(target, a, b);
+      sort2(target, b, c);
+      sort2(target, a, b);
+    }
+
+    void siftDown(Range& target, size_t base, size_t root, size_t end){
+      while(2*root+1 < end){
+        size_t child = 2*root+1;
+        if(child+1 < end && target[base+child] < target[base+child+1]) child++;
+        if(!(target[base+root] < target[base+child])) return;
+        swap(target[base+root], target[base+child]);
+        root = child;
+      }
+    }
+
+    void heapSort(Range& target, size_t begin, size_t end){
+      size_t size = end - begin;
+      for(size_t start = size/2; start-- > 0;)
+        siftDown(target, begin, start, size);
+      for(size_t last = size-1; last > 0; last--){
+        swap(target[begin], target[begin+last]);
+        siftDown(target, begin, 0, last);
+      }
+    }
+
+    // Moves num misplaced pairs found by the block scan. With unequal counts
+    // a cyclic rotation needs fewer writes than pairwise swaps.
+    void swapOffsets(Range& target, size_t first, size_t last, const unsigned char* offsets_l, const unsigned char* offsets_r, size_t num, bool use_swaps){
+      if(use_swaps){
+        for(size_t i = 0; i < num; i++)
+          swap(target[first + offsets_l[i]], target[last - offsets_r[i]]);
+      }else if(num > 0){
+        size_t l = first + offsets_l[0];
+        size_t r = last - offsets_r[0];
+        T tmp = target[l];
+        target[l] = target[r];
+        for(size_t i = 1; i < num; i++){
+          l = first + offsets_l[i];
+          target[r] = target[l];
+          r = last - offsets_r[i];
+          target[l] = target[r];
+        }
+        target[r] = tmp;
+      }
+    }
+
+    // Partitions [begin, end) around target[begin], elements equal to the
+    // pivot go right. Returns the pivot position and whether nothing moved.
+    size_t partitionRight(Range& target, size_t begin, size_t end, bool& already_partitioned){
+      T pivot = target[begin];
+      size_t first = begin;
+      size_t last = end;
+
+      while(target[++first] < pivot);
+      if(first-1 == begin)
+        while(first < last && !(target[--last] < pivot));
+      else
+        while(!(target[--last] < pivot));
+
+      already_partitioned = first >= last;
+      if(!already_partitioned){
+        swap(target[first], target[last]);
+        first++;
+
+        // classify whole blocks into offset buffers without branching on the
+        // comparison, then swap the misplaced elements pairwise
+        unsigned char offsets_l_storage[block_size];
+        unsigned char offsets_r_storage[block_size];
+        unsigned char* offsets_l = offsets_l_storage;
+        unsigned char* offsets_r = offsets_r_storage;
+        size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while(last - first > 2*block_size){
+          if(num_l == 0){
+            start_l = 0;
+            for(size_t i = 0; i < block_size; i++){
+              offsets_l[num_l] = i;
+              num_l += !(target[first+i] < pivot);
+            }
+          }
+          if(num_r == 0){
+            start_r = 0;
+            for(size_t i = 0; i < block_size; i++){
+              offsets_r[num_r] = i+1;
+              num_r += target[last-i-1] < pivot;
+            }
+          }
+
+          size_t num = std::min(num_l, num_r);
+          swapOffsets(target, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+          num_l -= num; num_r -= num;
+          start_l += num; start_r += num;
+          if(num_l == 0) first += block_size;
+          if(num_r == 0) last -= block_size;
+        }
+
+        size_t l_size = 0, r_size = 0;
+        size_t unknown_left = (last - first) - ((num_r || num_l) ? block_size : 0);
+        if(num_r){
+          l_size = unknown_left;
+          r_size = block_size;
+        }else if(num_l){
+          l_size = block_size;
+          r_size = unknown_left;
+        }else{
+          l_size = unknown_left/2;
+          r_size = unknown_left - l_size;
+        }
+
+        if(unknown_left && !num_l){
+          start_l = 0;
+          for(size_t i = 0; i < l_size; i++){
+            offsets_l[num_l] = i;
+            num_l += !(target[first+i] < pivot);
+          }
+        }
+        if(unknown_left && !num_r){
+          start_r = 0;
+          for(size_t i = 0; i < r_size; i++){
+            offsets_r[num_r] = i+1;
+            num_r += target[last-i-1] < pivot;
+          }
+        }
+
+        size_t num = std::min(num_l, num_r);
+        swapOffsets(target, first, last, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r);
+        num_l -= num; num_r -= num;
+        start_l += num; start_r += num;
+        if(num_l == 0) first += l_size;
+        if(num_r == 0) last -= r_size;
+
+        // one side may still have misplaced elements, move them to the middle
+        if(num_l){
+          offsets_l += start_l;
+          while(num_l--) swap(target[first + offsets_l[num_l]], target[--last]);
+          first = last;
+        }
+        if(num_r){
+          offsets_r += start_r;
+          while(num_r--) swap(target[last - offsets_r[num_r]], target[first]), first++;
+          last = first;
+        }
+      }
+
+      size_t pivot_pos = first-1;
+      target[begin] = target[pivot_pos];
+      target[pivot_pos] = pivot;
+      return pivot_pos;
+    }
+
+    // Partitions with elements equal to the pivot going left, used when the
+    // pivot equals the element before the range so the whole run is skipped
+    size_t partitionLeft(Range& target, size_t begin, size_t end){
+      T pivot = target[begin];
+      size_t first = begin;
+      size_t last = end;
+
+      while(pivot < target[--last]);
+      if(last+1 == end)
+        while(first < last && !(pivot < target[++first]));
+      else
+        while(!(pivot < target[++first]));
+
+      while(first < last){
+        swap(target[first], target[last]);
+        while(pivot < target[--last]);
+        while(!(pivot < target[++first]));
+      }
+
+      size_t pivot_pos = last;
+      target[begin] = target[pivot_pos];
+      target[pivot_pos] = pivot;
+      return pivot_pos;
+    }
+
+    void loop(Range& target, const CancellationToken& token, size_t begin, size_t end, int bad_allowed, bool leftmost){
+      while(!token.cancelled()){
+        size_t size = end - begin;
+        if(size < insertion_sort_threshold){
+          insertionSort(target, begin, end, !leftmost);
+          return;
+        }
+
+        size_t s2 = size/2;
+        if(size > ninther_threshold){
+          sort3(target, begin, begin+s2, end-1);
+          sort3(target, begin+1, begin+s2-1, end-2);
+          sort3(target, begin+2, begin+s2+1, end-3);
+          sort3(target, begin+s2-1, begin+s2, begin+s2+1);
+          swap(target[begin], target[begin+s2]);
+        }else{
+          sort3(target, begin+s2, begin, end-1);
+        }
+
+        if(!leftmost && !(target[begin-1] < target[begin])){
+          begin = partitionLeft(target, begin, end) + 1;
+          continue;
+        }
+
+        bool already_partitioned;
+        size_t pivot_pos = partitionRight(target, begin, end, already_partitioned);
+
+        size_t l_size = pivot_pos - begin;
+        size_t r_size = end - (pivot_pos+1);
+        if(l_size < size/8 || r_size < size/8){
+          if(--bad_allowed == 0){
+            heapSort(target, begin, end);
+            return;
+          }
+
+          // shuffle a few elements around to break the pattern
+          if(l_size >= insertion_sort_threshold){
+            swap(target[begin], target[begin + l_size/4]);
+            swap(target[pivot_pos-1], target[pivot_pos - l_size/4]);
+            if(l_size > ninther_threshold){
+              swap(target[begin+1], target[begin + (l_size/4+1)]);
+              swap(target[begin+2], target[begin + (l_size/4+2)]);
+              swap(target[pivot_pos-2], target[pivot_pos - (l_size/4+1)]);
+              swap(target[pivot_pos-3], target[pivot_pos - (l_size/4+2)]);
+            }
+          }
+          if(r_size >= insertion_sort_threshold){
+            swap(target[pivot_pos+1], target[pivot_pos + (1 + r_size/4)]);
+            swap(target[end-1], target[end - r_size/4]);
+            if(r_size > ninther_threshold){
+              swap(target[pivot_pos+2], target[pivot_pos + (2 + r_size/4)]);
+              swap(target[pivot_pos+3], target[pivot_pos + (3 + r_size/4)]);
+              swap(target[end-2], target[end - (1 + r_size/4)]);
+              swap(target[end-3], target[end - (2 + r_size/4)]);
+            }
+          }
+        }else if(already_partitioned
+            && partialInsertionSort(target, begin, pivot_pos)
+            && partialInsertionSort(target, pivot_pos+1, end)){
+          return;
+        }
+
+        loop(target, token, begin, pivot_pos, bad_allowed, leftmost);
+        begin = pivot_pos+1;
+        leftmost = false;
+      }
+    }
+
+  public:
+    void sort(Range& target, const CancellationToken& token, size_t begin, size_t end){
+      size_t size = end - begin;
+      if(size < 2) return;
+      int log2 = 0;
+      while(size >>= 1) log2++;
+      loop(target, token, begin, end, log2, true);
+    }
+
+    void run(Range target, const CancellationToken& token){
+      sort(target, token, 0, target.size());
+    }
+  };
+
+  // Timsort (Tim Peters, as in CPython's listsort): natural runs, with
+  // short ones extended to minrun by binary insertion, kept on a stack
+  // whose lengths shrink faster than the Fibonacci numbers. Merges copy
+  // the shorter run out and switch to galloping (exponential then binary
+  // search) while one side keeps winning. Sorted input is a single run.
+  template <typename Target> class TimSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+
+    static const size_t min_merge = 64;
+    static const size_t initial_min_gallop = 7;
+
+    struct Run {
+      size_t base;
+      size_t length;
+    };
+
+    // state of a single sort, instances stay reentrant
+    struct State {
+      Range& target;
+      vector<T> scratch;
+      vector<Run> runs;
+      size_t min_gallop = initial_min_gallop;
+
+      State(Range& target) : target(target) {}
+    };
+
+    // n itself below min_merge, else between min_merge/2 and min_merge so
+    // that n/minrun is a power of two or just below one
+    static size_t minRun(size_t n){
+      size_t r = 0;
+      while(n >= min_merge){
+        r |= n & 1;
+        n >>= 1;
+      }
+      return n + r;
+    }
+
+    // Length of the run starting at begin; strictly descending runs are
+    // reversed in place, which keeps equal elements in order
+    static size_t countRun(Range& target, size_t begin, size_t end){
+      if(end - begin < 2) return end - begin;
+      T first = target[begin];
+      T previous = target[begin+1];
+      bool descending = target.less(previous, first);
+      size_t i = begin + 2;
+      for(; i < end; i++){
+        T current = target[i];
+        if(descending ? !target.less(current, previous) : target.less(current, previous)) break;
+        previous = std::move(current);
+      }
+      if(descending)
+        for(size_t lo = begin, hi = i - 1; lo < hi; lo++, hi--)
+          swap(target[lo], target[hi]);
+      return i - begin;
+    }
+
+    // [begin, start) is sorted already
+    static void binaryInsertionSort(Range& target, size_t begin, size_t end, size_t start){
+      for(size_t i = start; i < end; i++){
+        T pivot = target[i];
+        size_t lo = begin, hi = i;
+        while(lo < hi){
+          size_t mid = lo + (hi - lo) / 2;
+          if(target.less(pivot, target[mid])) hi = mid;
+          else lo = mid + 1;
+        }
+        for(size_t j = i; j > lo; j--)
+          target[j] = target[j-1];
+        target[lo] = std::move(pivot);
+      }
+    }
+
+    // First position in the sorted a[0, n) where key could go, searched
+    // outwards from hint first; at(i) reads a[i]
+    template <typename At> static size_t gallopLeft(Range& target, const T& key, At at, ptrdiff_t n, ptrdiff_t hint){
+      ptrdiff_t last = 0, offset = 1;
+      if(target.less(at(hint), key)){
+        // a[hint + last] < key <= a[hint + offset]
+        ptrdiff_t max_offset = n - hint;
+        while(offset < max_offset && target.less(at(hint + offset), key)){
+          last = offset;
+          offset = (offset << 1) + 1;
+        }
+        offset = std::min(offset, max_offset);
+        last += hint;
+        offset += hint;
+      }else{
+        // a[hint - offset] < key <= a[hint - last]
+        ptrdiff_t max_offset = hint + 1;
+        while(offset < max_offset && !target.less(at(hint - offset), key)){
+          last = offset;
+          offset = (offset << 1) + 1;
+        }
+        offset = std::min(offset, max_offset);
+        ptrdiff_t k = last;
+        last = hint - offset;
+        offset = hint - k;
+      }
+      // a[last] < key <= a[offset], last may be -1
+      for(last++; last < offset;){
+        ptrdiff_t mid = last + (offset - last) / 2;
+        if(target.less(at(mid), key)) last = mid + 1;
+        else offset = mid;
+      }
+      return offset;
+    }
+
+    // Like gallopLeft, but past any elements equal to key
+    template <typename At> static size_t gallopRight(Range& target, const T& key, At at, ptrdiff_t n, ptrdiff_t hint){
+      ptrdiff_t last = 0, offset = 1;
+      if(target.less(key, at(hint))){
+        // a[hint - offset] <= key < a[hint - last]
+        ptrdiff_t max_offset = hint + 1;
+        while(offset < max_offset && target.less(key, at(hint - offset))){
+          last = offset;
+          offset = (offset << 1) + 1;
+        }
+        offset = std::min(offset, max_offset);
+        ptrdiff_t k = last;
+        last = hint - offset;
+        offset = hint - k;
+      }else{
+        // a[hint + last] <= key < a[hint + offset]
+        ptrdiff_t max_offset = n - hint;
+        while(offset < max_offset && !target.less(key, at(hint + offset))){
+          last = offset;
+          offset = (offset << 1) + 1;
+        }
+        offset = std::min(offset, max_offset);
+        last += hint;
+        offset += hint;
+      }
+      // a[last] <= key < a[offset], last may be -1
+      for(last++; last < offset;){
+        ptrdiff_t mid = last + (offset - last) / 2;
+        if(target.less(key, at(mid))) offset = mid;
+        else last = mid + 1;
+      }
+      return offset;
+    }
+
+    // Merges a = [base_a, base_a + na) with the b directly after it, na <= nb.
+    // a[0] > b[0] and a[na-1] > b[nb-1], so b[0] goes first and a's last
+    // element last. a is copied out and merged back from the left.
+    static void mergeLo(State& state, size_t base_a, size_t na, size_t base_b, size_t nb){
+      Range& target = state.target;
+      vector<T>& a = state.scratch;
+      a.resize(na);
+      for(size_t i = 0; i < na; i++)
+        a[i] = target[base_a + i];
+
+      size_t dest = base_a, pa = 0, pb = base_b;
+      target[dest++] = target[pb++];
+      nb--;
+
+      // returns once b is used up or a is down to its last element
+      [&]{
+        if(nb == 0 || na == 1) return;
+        size_t& min_gallop = state.min_gallop;
+        for(;;){
+          size_t a_wins = 0, b_wins = 0;
+          // one pair at a time until either side wins min_gallop in a row
+          for(;;){
+            T b = target[pb];
+            if(target.less(b, a[pa])){
+              target[dest++] = std::move(b);
+              pb++;
+              b_wins++;
+              a_wins = 0;
+              if(--nb == 0) return;
+              if(b_wins >= min_gallop) break;
+            }else{
+              target[dest++] = std::move(a[pa++]);
+              a_wins++;
+              b_wins = 0;
+              if(--na == 1) return;
+              if(a_wins >= min_gallop) break;
+            }
+          }
+
+          // gallop while that pays off, and make it easier to get back to
+          min_gallop++;
+          do{
+            min_gallop -= min_gallop > 1;
+            size_t k = gallopRight(target, target[pb], [&](size_t i) -> const T& { return a[pa + i]; }, na, 0);
+            a_wins = k;
+            for(; k > 0; k--, na--)
+              target[dest++] = std::move(a[pa++]);
+            if(na <= 1) return;
+            target[dest++] = target[pb++];
+            if(--nb == 0) return;
+
+            k = gallopLeft(target, a[pa], [&](size_t i) -> T { return target[pb + i]; }, nb, 0);
+            b_wins = k;
+            for(; k > 0; k--, nb--)
+              target[dest++] = target[pb++];
+            if(nb == 0) return;
+            target[dest++] = std::move(a[pa++]);
+            if(--na == 1) return;
+          }while(a_wins >= initial_min_gallop || b_wins >= initial_min_gallop);
+          min_gallop++;
+        }
+      }();
+
+      // whatever is left of b moves down, a's rest follows it
+      for(; nb > 0; nb--)
+        target[dest++] = target[pb++];
+      for(; na > 0; na--)
+        target[dest++] = std::move(a[pa++]);
+    }
+
+    // Mirror image of mergeLo for nb < na: b is copied out and merged back
+    // from the right
+    static void mergeHi(State& state, size_t base_a, size_t na, size_t base_b, size_t nb){
+      Range& target = state.target;
+      vector<T>& b = state.scratch;
+      b.resize(nb);
+      for(size_t i = 0; i < nb; i++)
+        b[i] = target[base_b + i];
+
+      // one past the next slot to fill and past the last elements left
+      size_t dest = base_b + nb, pa = base_a + na, pb = nb;
+      target[--dest] = target[--pa];
+      na--;
+
+      // returns once a is used up or b is down to its first element
+      [&]{
+        if(na == 0 || nb == 1) return;
+        size_t& min_gallop = state.min_gallop;
+        for(;;){
+          size_t a_wins = 0, b_wins = 0;
+          for(;;){
+            T a = target[pa - 1];
+            if(target.less(b[pb - 1], a)){
+              target[--dest] = std::move(a);
+              pa--;
+              a_wins++;
+              b_wins = 0;
+              if(--na == 0) return;
+              if(a_wins >= min_gallop) break;
+            }else{
+              target[--dest] = std::move(b[--pb]);
+              b_wins++;
+              a_wins = 0;
+              if(--nb == 1) return;
+              if(b_wins >= min_gallop) break;
+            }
+          }
+
+          min_gallop++;
+          do{
+            min_gallop -= min_gallop > 1;
+            // elements of a greater than b's last go first
+            size_t k = na - gallopRight(target, b[pb - 1], [&](size_t i) -> T { return target[base_a + i]; }, na, na - 1);
+            a_wins = k;
+            for(; k > 0; k--, na--)
+              target[--dest] = target[--pa];
+            if(na == 0) return;
+            target[--dest] = std::move(b[--pb]);
+            if(--nb == 1) return;
+
+            // then elements of b not less than a's last
+            k = nb - gallopLeft(target, target[pa - 1], [&](size_t i) -> const T& { return b[i]; }, nb, nb - 1);
+            b_wins = k;
+            for(; k > 0; k--, nb--)
+              target[--dest] = std::move(b[--pb]);
+            if(nb <= 1) return;
+            target[--dest] = target[--pa];
+            if(--na == 0) return;
+          }while(a_wins >= initial_min_gallop || b_wins >= initial_min_gallop);
+          min_gallop++;
+        }
+      }();
+
+      // whatever is left of a moves up, b's rest goes in front of it
+      for(; na > 0; na--)
+        target[--dest] = target[--pa];
+      for(; nb > 0; nb--)
+        target[--dest] = std::move(b[--pb]);
+    }
+
+    // Merges runs i and i+1 of the stack, skipping the prefix of a and the
+    // suffix of b that are already in place
+    static void mergeAt(State& state, size_t i){
+      Range& target = state.target;
+      vector<Run>& runs = state.runs;
+      size_t base_a = runs[i].base, na = runs[i].length;
+      size_t base_b = runs[i+1].base, nb = runs[i+1].length;
+      runs[i].length = na + nb;
+      runs.erase(runs.begin() + i + 1);
+
+      size_t k = gallopRight(target, target[base_b], [&](size_t j) -> T { return target[base_a + j]; }, na, 0);
+      base_a += k;
+      na -= k;
+      if(na == 0) return;
+      nb = gallopLeft(target, target[base_a + na - 1], [&](size_t j) -> T { return target[base_b + j]; }, nb, nb - 1);
+      if(nb == 0) return;
+
+      if(na <= nb) mergeLo(state, base_a, na, base_b, nb);
+      else mergeHi(state, base_a, na, base_b, nb);
+    }
+
+    // Restores len[n-2] > len[n-1] + len[n] and len[n-1] > len[n] for the
+    // top of the stack, also one level further down (the case the
+    // original formulation missed)
+    static void mergeCollapse(State& state){
+      vector<Run>& runs = state.runs;
+      while(runs.size() > 1){
+        size_t n = runs.size() - 2;
+        if((n > 0 && runs[n-1].length <= runs[n].length + runs[n+1].length) ||
+           (n > 1 && runs[n-2].length <= runs[n-1].length + runs[n].length)){
+          if(runs[n-1].length < runs[n+1].length) n--;
+        }else if(runs[n].length > runs[n+1].length){
+          return;
+        }
+        mergeAt(state, n);
+      }
+    }
+
+    static void mergeForceCollapse(State& state){
+      vector<Run>& runs = state.runs;
+      while(runs.size() > 1){
+        size_t n = runs.size() - 2;
+        if(n > 0 && runs[n-1].length < runs[n+1].length) n--;
+        mergeAt(state, n);
+      }
+    }
+
+  public:
+    void run(Range target, const CancellationToken& token){
+      size_t size = target.size();
+      if(size < 2) return;
+      State state(target);
+      size_t min_run = minRun(size);
+      for(size_t begin = 0; begin < size; ){
+        // merges are never left half done, a cancelled sort is still a permutation
+        if(token.cancelled()) return;
+        size_t length = countRun(target, begin, size);
+        if(length < min_run){
+          size_t forced = std::min(min_run, size - begin);
+          binaryInsertionSort(target, begin, begin + forced, begin + length);
+          length = forced;
+        }
+        state.runs.push_back({begin, length});
+        mergeCollapse(state);
+        begin += length;
+      }
+      mergeForceCollapse(state);
+    }
+  };
+
+  // The standard library's introsort through TracedIterator, as a baseline.
+  // std::sort has no way to stop early, so the comparator checks the token
+  // every few thousand comparisons and unwinds out of it; the array is left
+  // in whatever state the sort had reached.
+  template <typename Target> class StdSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    struct Cancelled {};
+
+  public:
+    void run(Range target, const CancellationToken& token){
+      size_t steps = 0;
+      try{
+        std::sort(target.begin(), target.end(), [&](const auto& a, const auto& b){
+          if(++steps % 4096 == 0 && token.cancelled()) throw Cancelled();
+          return a < b;
+        });
+      }catch(const Cancelled&){}
+    }
+  };
+
+  // Least significant digit first. All digit histograms come out of a single
+  // read pass up front, and passes whose digit is the same for every key are
+  // skipped. Each pass copies into a scratch buffer and scatters back, so the
+  // scatter is what shows up in the trace.
+  template <typename Target> class LsdRadixSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+    using Traits = ElementTraits<T>;
+    unsigned bits;
+
+  public:
+    LsdRadixSort(unsigned bits) : bits(bits) {}
+
+    void run(Range target, const CancellationToken& token){
+      size_t size = target.size();
+      size_t radix = (size_t)1 << bits;
+      typename Traits::Key mask = radix - 1;
+      unsigned passes = (sizeof(typename Traits::Key) * 8 + bits - 1) / bits;
+
+      vector<size_t> counts(passes * radix, 0);
+      for(size_t i = 0; i < size; i++){
+        typename Traits::Key key = Traits::key(target[i]);
+        for(unsigned pass = 0; pass < passes; pass++)
+          counts[pass*radix + ((key >> (pass*bits)) & mask)]++;
+      }
+
+      vector<T> scratch(size);
+      for(unsigned pass = 0; pass < passes && !token.cancelled(); pass++){
+        size_t* count = &counts[pass*radix];
+        unsigned shift = pass*bits;
+        if(size == 0 || count[(Traits::key(target.peek(0)) >> shift) & mask] == size) continue;
+
+        size_t offset = 0;
+        for(size_t digit = 0; digit < radix; digit++){
+          size_t c = count[digit];
+          count[digit] = offset;
+          offset += c;
+        }
+
+        for(size_t i = 0; i < size; i++)
+          scratch[i] = target[i];
+        for(size_t i = 0; i < size; i++){
+          const T& value = scratch[i];
+          target[count[(Traits::key(value) >> shift) & mask]++] = value;
+        }
+      }
+    }
+  };
+
+  // Most significant digit first, in place (American flag sort): count one
+  // byte, permute every element directly into its bucket by cycle leading,
+  // then recurse into each bucket on the next byte
+  template <typename Target> class MsdRadixSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+    using Traits = ElementTraits<T>;
+    static const size_t insertion_sort_threshold = 32;
+
+    void sort(Range& target, const CancellationToken& token, size_t begin, size_t end, int shift){
+      if(token.cancelled()) return;
+      if(end - begin < insertion_sort_threshold){
+        insertion_sort(target, begin, end);
+        return;
+      }
+
+      size_t counts[256] = {0};
+      for(size_t i = begin; i < end; i++)
+        counts[(Traits::key(target[i]) >> shift) & 0xff]++;
+
+      size_t heads[256];
+      size_t tails[256];
+      size_t offset = begin;
+      for(size_t digit = 0; digit < 256; digit++){
+        heads[digit] = offset;
+        offset += counts[digit];
+        tails[digit] = offset;
+      }
+
+      for(size_t digit = 0; digit < 256; digit++){
+        if(counts[digit] == end - begin) break;
+        while(heads[digit] < tails[digit]){
+          T value = target[heads[digit]];
+          size_t d = (Traits::key(value) >> shift) & 0xff;
+          while(d != digit){
+            T displaced = target[heads[d]];
+            target[heads[d]++] = value;
+            value = displaced;
+            d = (Traits::key(value) >> shift) & 0xff;
+          }
+          target[heads[digit]++] = value;
+        }
+      }
+
+      if(shift == 0) return;
+      offset = begin;
+      for(size_t digit = 0; digit < 256; digit++){
+        if(counts[digit] > 1) sort(target, token, offset, offset + counts[digit], shift - 8);
+        offset += counts[digit];
+      }
+    }
+
+  public:
+    void run(Range target, const CancellationToken& token){
+      sort(target, token, 0, target.size(), sizeof(typename Traits::Key) * 8 - 8);
+    }
+  };
+  // Top-down merge sort on the scheduler. Both halves are forked, and the
+  // merge itself is parallel too: the output is cut into equal chunks and
+  // each chunk finds where it starts in both runs by co-ranking (a binary
+  // search on the split point), so chunks merge independently.
+  template <typename Target> class ParallelMergeSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+
+    static const size_t insertion_sort_threshold = 32;
+    static const size_t fork_threshold = 4096;
+    static const size_t merge_grain = 4096;
+
+    // how many of the first i elements of the stable merge of a and b come from a
+    static size_t corank(Range& target, size_t i, const T* a, size_t m, const T* b, size_t n){
+      size_t lo = i > n ? i - n : 0;
+      size_t hi = std::min(i, m);
+      while(lo < hi){
+        size_t j = lo + (hi - lo) / 2;
+        size_t k = i - j;
+        if(k > 0 && j < m && !target.less(b[k-1], a[j])) lo = j + 1;
+        else hi = j;
+      }
+      return lo;
+    }
+
+    void merge(Range& target, vector<T>& scratch, size_t begin, size_t mid, size_t end){
+      Scheduler& pool = scheduler();
+      pool.parallel_for(begin, end, merge_grain, [&](size_t from, size_t to){
+        for(size_t i = from; i < to; i++)
+          scratch[i] = target[i];
+      });
+
+      const T* a = &scratch[begin];
+      const T* b = &scratch[mid];
+      size_t m = mid - begin;
+      size_t n = end - mid;
+      pool.parallel_for(0, end - begin, merge_grain, [&](size_t from, size_t to){
+        size_t j = corank(target, from, a, m, b, n);
+        size_t k = from - j;
+        size_t j_end = corank(target, to, a, m, b, n);
+        size_t k_end = to - j_end;
+        for(size_t out = begin + from; out < begin + to; out++){
+          if(j < j_end && (k >= k_end || !target.less(b[k], a[j]))) target[out] = a[j++];
+          else target[out] = b[k++];
+        }
+      });
+    }
+
+    void sort(Range& target, const CancellationToken& token, vector<T>& scratch, size_t begin, size_t end){
+      if(token.cancelled()) return;
+      if(end - begin <= insertion_sort_threshold){
+        insertion_sort(target, begin, end);
+        return;
+      }
+
+      size_t mid = begin + (end - begin) / 2;
+      if(end - begin > fork_threshold){
+        scheduler().fork_join(
+          [&]{ sort(target, token, scratch, begin, mid); },
+          [&]{ sort(target, token, scratch, mid, end); }
+        );
+      }else{
+        sort(target, token, scratch, begin, mid);
+        sort(target, token, scratch, mid, end);
+      }
+      // co-ranking needs both halves sorted
+      if(token.cancelled()) return;
+      merge(target, scratch, begin, mid, end);
+    }
+
+  public:
+    void run(Range target, const CancellationToken& token){
+      vector<T> scratch(target.size());
+      sort(target, token, scratch, 0, target.size());
+    }
+  };
+
+  // Single level parallel sample sort. Splitters come from a sorted
+  // oversample and are laid out as an implicit search tree, so classifying
+  // an element is a fixed number of branchless steps. Every stripe of the
+  // input is classified by one task into per-bucket write-combining
+  // buffers that are flushed to the bucket's slot of the output a line at
+  // a time; a prefix sum over the per-stripe histograms gives the slots.
+  // The buckets are then sorted in parallel with pdqsort.
+  template <typename Target> class SampleSort : public IAlgo<Target> {
+  private:
+    using Range = TracedRange<Target>;
+    using T = typename Target::value_type;
+
+    static const size_t sequential_threshold = 1 << 14;
+    static const size_t max_buckets = 256;
+    static const size_t oversampling = 16;
+    static const size_t buffer_size = 16;
+
+    PdqSort<Target> base;
+
+  public:
+    void run(Range target, const CancellationToken& token){
+      size_t size = target.size();
+      Scheduler& pool = scheduler();
+      if(size < sequential_threshold){
+        base.sort(target, token, 0, size);
+        return;
+      }
+
+      size_t buckets = 2;
+      while(buckets < max_buckets && buckets * sequential_threshold / 4 < size) buckets *= 2;
+      unsigned log_buckets = 0;
+      while(((size_t)1 << log_buckets) < buckets) log_buckets++;
+
+      // oversample, sort and keep every oversampling'th element as a splitter
+      minstd_rand rng(size);
+      vector<T> sample(buckets * oversampling);
+      for(T& value : sample) value = target[rng() % size];
+      std::sort(sample.begin(), sample.end(), target.comparator);
+      vector<T> tree(buckets);
+      vector<T> splitters(buckets - 1);
+      for(size_t i = 0; i < buckets - 1; i++) splitters[i] = sample[(i+1) * oversampling];
+
+      // all splitters equal means one bucket would get everything
+      if(!target.comparator(splitters.front(), splitters.back())){
+        base.sort(target, token, 0, size);
+        return;
+      }
+
+      // tree[1] is the median splitter, the children of j are 2j and 2j+1
+      std::function<void(size_t, size_t, size_t)> build = [&](size_t node, size_t lo, size_t hi){
+        if(node >= buckets) return;
+        size_t mid = lo + (hi - lo) / 2;
+        tree[node] = splitters[mid];
+        build(2*node, lo, mid);
+        build(2*node + 1, mid + 1, hi);
+      };
+      build(1, 0, buckets - 1);
+
+      auto classify = [&](const T& value){
+        size_t node = 1;
+        for(unsigned level = 0; level < log_buckets; level++)
+          node = 2*node + target.less(tree[node], value);
+        return node - buckets;
+      };
+
+      size_t stripes = max((size_t)1, (size_t)pool.size());
+      size_t stripe_size = (size + stripes - 1) / stripes;
+      vector<T> values(size);
+      vector<uint8_t> oracle(size);
+      vector<size_t> counts(stripes * buckets, 0);
+
+      pool.parallel_for(0, stripes, 1, [&](size_t first, size_t last){
+        for(size_t stripe = first; stripe < last; stripe++){
+          size_t* count = &counts[stripe * buckets];
+          size_t end = min(size, (stripe + 1) * stripe_size);
+          for(size_t i = stripe * stripe_size; i < end; i++){
+            T value = target[i];
+            size_t bucket = classify(value);
+            values[i] = value;
+            oracle[i] = bucket;
+            count[bucket]++;
+          }
+        }
+      });
+
+      if(token.cancelled()) return;
+
+      // bucket major, so each bucket's stripes end up next to each other
+      vector<size_t> bounds(buckets + 1);
+      size_t offset = 0;
+      for(size_t bucket = 0; bucket < buckets; bucket++){
+        bounds[bucket] = offset;
+        for(size_t stripe = 0; stripe < stripes; stripe++){
+          size_t c = counts[stripe * buckets + bucket];
+          counts[stripe * buckets + bucket] = offset;
+          offset += c;
+        }
+      }
+      bounds[buckets] = size;
+
+      pool.parallel_for(0, stripes, 1, [&](size_t first, size_t last){
+        vector<T> buffers(buckets * buffer_size);
+        vector<size_t> fill(buckets);
+        for(size_t stripe = first; stripe < last; stripe++){
+          size_t* out = &counts[stripe * buckets];
+          std::fill(fill.begin(), fill.end(), 0);
+          size_t end = min(size, (stripe + 1) * stripe_size);
+          for(size_t i = stripe * stripe_size; i < end; i++){
+            size_t bucket = oracle[i];
+            T* buffer = &buffers[bucket * buffer_size];
+            buffer[fill[bucket]++] = values[i];
+            if(fill[bucket] == buffer_size){
+              for(size_t j = 0; j < buffer_size; j++) target[out[bucket]++] = buffer[j];
+              fill[bucket] = 0;
+            }
+          }
+          for(size_t bucket = 0; bucket < buckets; bucket++)
+            for(size_t j = 0; j < fill[bucket]; j++) target[out[bucket]++] = buffers[bucket * buffer_size + j];
+        }
+      });
+
+      pool.parallel_for(0, buckets, 1, [&](size_t first, size_t last){
+        for(size_t bucket = first; bucket < last; bucket++)
+          base.sort(target, token, bounds[bucket], bounds[bucket + 1]);
+      });
+    }
+  };
+
   // Utility stuff
-  map<string, IAlgo*> algos;
-  template <typename T> void swap(T &a, T &b){
-    T temp = a;
-    a = b;
-    b = temp;
-    if(!running) throw InterruptedException();
+  template <typename Target> void reg(string name, IAlgo<Target>* func, const Capabilities& promises){
+    algos<typename Target::trace_type, typename Target::value_type, typename Target::compare_type>[name] = func;
+    capabilities[name] = promises;
+  }
+  // beyond this the quadratic sorts take minutes
+  const size_t quadratic_max_n = 1 << 17;
+  template <typename Trace, typename T = int, typename Compare = std::less<T>> void init(){
+    using Target = Array<Trace, T, Compare>;
+    reg("Bubble Sort", new BubbleSort<Target>(), {Stable | InPlace | Adaptive, "n^2", quadratic_max_n});
+    reg("Cocktail Shaker Sort", new CocktailShakerSort<Target>(), {Stable | InPlace | Adaptive, "n^2", quadratic_max_n});
+    reg("Selection Sort", new SelectionSort<Target>(), {InPlace, "n^2", quadratic_max_n});
+    // expected n! shuffles
+    reg("Monkey Sort", new MonkeySort<Target>(), {InPlace | Adaptive, "n*n!", 10});
+    reg("Insertion Sort", new InsertionSort<Target>(), {Stable | InPlace | Adaptive, "n^2", quadratic_max_n});
+    reg("Comb Sort", new CombSort<Target>(), {InPlace, "n^2/2^p"});
+    reg("Heap Sort", new HeapSort<Target>(), {InPlace, "n log n"});
+    reg("Gnome Sort", new GnomeSort<Target>(), {Stable | InPlace | Adaptive, "n^2", quadratic_max_n});
+    reg("Pdq Sort", new PdqSort<Target>(), {InPlace | Adaptive, "n log n"});
+    reg("Tim Sort", new TimSort<Target>(), {Stable | Adaptive, "n log n"});
+    reg("std::sort", new StdSort<Target>(), {InPlace, "n log n"});
+    // radix sorts need an unsigned key in the comparator's order
+    if constexpr(HasRadixKey<T>::value && std::is_same_v<Compare, std::less<T>>){
+      reg("LSD Radix Sort (8-bit)", new LsdRadixSort<Target>(8), {Stable, "n*w/8"});
+      reg("LSD Radix Sort (11-bit)", new LsdRadixSort<Target>(11), {Stable, "n*w/11"});
+      reg("MSD Radix Sort", new MsdRadixSort<Target>(), {InPlace, "n*w/8"});
+    }
+    reg("Parallel Merge Sort", new ParallelMergeSort<Target>(), {Stable, "n log n"});
+    reg("Parallel Sample Sort", new SampleSort<Target>(), {0, "n log n"});
   }
-  void reg(string name, IAlgo* func){
-    algos[name] = func;
+  template <typename Trace, typename T = int, typename Compare = std::less<T>> void deinit(){
+    for(pair<const string, IAlgo<Array<Trace, T, Compare>>*>& a : algos<Trace, T, Compare>)
+      delete a.second;
+    algos<Trace, T, Compare>.clear();
   }
+  // The live view, recordings and the callback tracer only deal in ints;
+  // the bench runs every element type untraced, counted and cached
   void init(){
-    reg("Bubble Sort", new BubbleSort());
-    reg("Cocktail Shaker Sort", new CocktailShakerSort());
-    reg("Selection Sort", new SelectionSort());
-    reg("Monkey Sort", new MonkeySort());
-    reg("Insertion Sort", new InsertionSort());
-    reg("Comb Sort", new CombSort());
-    reg("Heap Sort", new HeapSort());
-    reg("Gnome Sort", new GnomeSort());
+    init<CallbackTrace<int>>();
+    init<RecordingTrace>();
+    ElementTypes::each([](auto tag){
+      using T = typename decltype(tag)::type;
+      init<NoTrace, T>();
+      init<CountingTrace, T>();
+      init<CacheTrace<T>, T>();
+    });
   }
   void deinit(){
-    for(pair<string, IAlgo*> a : algos)
-      delete a.second;
-  }
-  void run(string name){
-    printf("Running %s\n", name.c_str());
-    algos[name]->run();
-    printf("Done\n");
+    capabilities.clear();
+    deinit<CallbackTrace<int>>();
+    deinit<RecordingTrace>();
+    ElementTypes::each([](auto tag){
+      using T = typename decltype(tag)::type;
+      deinit<NoTrace, T>();
+      deinit<CountingTrace, T>();
+      deinit<CacheTrace<T>, T>();
+    });
   }
 }
@@ -8,65 +8,266 @@
 #include <atomic>
 #include <iostream>
 #include <functional>
+#include <iterator>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+#include "trace.h"
 
 namespace algo {
-  class InterruptedException : virtual public std::exception {};
-  class IAlgo {
+  // Cooperative cancellation. Algorithms poll it at coarse points (per pass,
+  // per partition step, per recursion) and return early, leaving the array
+  // as it is; nothing on the per-access path checks it.
+  class CancellationToken {
+    std::atomic<bool> flag{false};
+
   public:
-    virtual ~IAlgo() {};
-    virtual void run() = 0;
+    void cancel(){
+      flag.store(true, std::memory_order_relaxed);
+    }
+
+    void reset(){
+      flag.store(false, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const {
+      return flag.load(std::memory_order_relaxed);
+    }
   };
 
-  template <typename T> struct TraceableAtom {
-    std::atomic<T> _a;
-    std::vector<std::function<void(TraceableAtom&)>> cb_read;
-    std::vector<std::function<void(TraceableAtom&)>> cb_write;
-    
-    operator T() {
-      for(std::function<void(TraceableAtom&)>& fun : cb_read) fun(*this);
-      return _a.load();
+  template <typename Array> class TracedRef {
+    using T = typename Array::value_type;
+    Array& array;
+    size_t index;
+
+    friend Array;
+    template <typename A> friend void swap(TracedRef<A> a, TracedRef<A> b);
+
+    TracedRef(Array& array, size_t index) : array(array), index(index) {}
+
+  public:
+    operator T() const {
+      array.read(index);
+      return array.data[index];
     }
 
-    T without_cb() {
-      return _a.load();
+    TracedRef& operator=(const T& value){
+      array.write(index, array.data[index], value);
+      array.data[index] = value;
+      return *this;
     }
 
-    TraceableAtom() {
+    // element to element assignment reads into a temporary, which can then
+    // be moved in instead of copied a second time
+    TracedRef& operator=(T&& value){
+      array.write(index, array.data[index], value);
+      array.data[index] = std::move(value);
+      return *this;
     }
 
-    TraceableAtom(const std::atomic<T>& a) {
-      _a.store(a.load());      
+    TracedRef& operator=(const TracedRef& other){
+      return *this = T(other);
     }
 
-    TraceableAtom(T& a) {
-      _a.store(a);      
+    // everything is phrased in terms of the array's comparator
+    friend bool operator<(const TracedRef& a, const TracedRef& b){ return a.array.less(T(a), T(b)); }
+    friend bool operator>(const TracedRef& a, const TracedRef& b){ return a.array.less(T(b), T(a)); }
+    friend bool operator<=(const TracedRef& a, const TracedRef& b){ return !a.array.less(T(b), T(a)); }
+    friend bool operator>=(const TracedRef& a, const TracedRef& b){ return !a.array.less(T(a), T(b)); }
+    friend bool operator<(const TracedRef& a, const T& b){ return a.array.less(T(a), b); }
+    friend bool operator>(const TracedRef& a, const T& b){ return a.array.less(b, T(a)); }
+    friend bool operator<(const T& a, const TracedRef& b){ return b.array.less(a, T(b)); }
+    friend bool operator>(const T& a, const TracedRef& b){ return b.array.less(T(b), a); }
+  };
+
+  // Random access iterator over a traced array, dereferencing to TracedRef so
+  // standard algorithms go through the same hooks
+  template <typename Array> class TracedIterator {
+    Array* array;
+    std::ptrdiff_t index;
+
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename Array::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = TracedRef<Array>;
+
+    TracedIterator() : array(nullptr), index(0) {}
+    TracedIterator(Array* array, std::ptrdiff_t index) : array(array), index(index) {}
+
+    reference operator*() const { return (*array)[index]; }
+    reference operator[](difference_type n) const { return (*array)[index + n]; }
+
+    TracedIterator& operator++(){ index++; return *this; }
+    TracedIterator& operator--(){ index--; return *this; }
+    TracedIterator operator++(int){ TracedIterator old = *this; index++; return old; }
+    TracedIterator operator--(int){ TracedIterator old = *this; index--; return old; }
+    TracedIterator& operator+=(difference_type n){ index += n; return *this; }
+    TracedIterator& operator-=(difference_type n){ index -= n; return *this; }
+    TracedIterator operator+(difference_type n) const { return TracedIterator(array, index + n); }
+    TracedIterator operator-(difference_type n) const { return TracedIterator(array, index - n); }
+    friend TracedIterator operator+(difference_type n, const TracedIterator& it){ return it + n; }
+    difference_type operator-(const TracedIterator& other) const { return index - other.index; }
+
+    bool operator==(const TracedIterator& other) const { return index == other.index; }
+    bool operator!=(const TracedIterator& other) const { return index != other.index; }
+    bool operator<(const TracedIterator& other) const { return index < other.index; }
+    bool operator>(const TracedIterator& other) const { return index > other.index; }
+    bool operator<=(const TracedIterator& other) const { return index <= other.index; }
+    bool operator>=(const TracedIterator& other) const { return index >= other.index; }
+  };
+
+  // Contiguous storage with a single set of trace hooks for the whole array.
+  // Elements are handed out as TracedRef proxies which call into the policy;
+  // they are ordered by Compare, and every comparison is traced.
+  template <typename T, typename Trace, typename Compare = std::less<T>> class TracedArray : public Trace {
+    std::vector<T> data;
+
+    friend class TracedRef<TracedArray>;
+
+  public:
+    using value_type = T;
+    using trace_type = Trace;
+    using compare_type = Compare;
+
+    Compare comparator;
+
+    bool less(const T& a, const T& b){
+      this->compare();
+      return comparator(a, b);
     }
 
-    TraceableAtom(const TraceableAtom& other) {
-      cb_read = other.cb_read;
-      cb_write = other.cb_write;
-      _a.store(other._a);
+    TracedRef<TracedArray> operator[](size_t index){
+      return TracedRef<TracedArray>(*this, index);
     }
 
-    TraceableAtom& operator=(const TraceableAtom& other){
-      for(std::function<void(TraceableAtom&)>& fun : cb_write) fun(*this);
-      _a.store(other._a.load());
-      return *this;
+    size_t size() const {
+      return data.size();
+    }
+
+    TracedIterator<TracedArray> begin(){
+      return TracedIterator<TracedArray>(this, 0);
+    }
+
+    TracedIterator<TracedArray> end(){
+      return TracedIterator<TracedArray>(this, data.size());
+    }
+
+    // untraced access, for seeding and rendering
+    T peek(size_t index) const {
+      return data[index];
+    }
+
+    void poke(size_t index, const T& value){
+      data[index] = value;
+    }
+
+    void push_back(const T& value){
+      data.push_back(value);
+    }
+
+    void assign(const std::vector<T>& values){
+      data = values;
+    }
+
+    void clear(){
+      data.clear();
     }
 
-    TraceableAtom& operator=(T& other){
-      _a.store(other);
+    Trace& trace(){
       return *this;
     }
   };
 
-  extern std::map<std::string, IAlgo*> algos;
-  void add(std::string name, IAlgo* func);
+  // The slice [first, last) of a traced array an algorithm works on. Indices
+  // are relative to the slice while the array's hooks still see absolute
+  // ones; the range carries no state of its own, so any number of them can
+  // be sorted at once, on one array or on several.
+  template <typename Array> class TracedRange {
+    Array* array;
+    size_t first;
+    size_t count;
+
+  public:
+    using value_type = typename Array::value_type;
+    using compare_type = typename Array::compare_type;
+
+    compare_type& comparator;
+
+    TracedRange(Array& array) : TracedRange(array, 0, array.size()) {}
+    TracedRange(Array& array, size_t first, size_t last) : array(&array), first(first), count(last - first), comparator(array.comparator) {}
+
+    TracedRef<Array> operator[](size_t index){
+      return (*array)[first + index];
+    }
+
+    size_t size() const {
+      return count;
+    }
+
+    TracedIterator<Array> begin(){
+      return TracedIterator<Array>(array, first);
+    }
+
+    TracedIterator<Array> end(){
+      return TracedIterator<Array>(array, first + count);
+    }
+
+    value_type peek(size_t index) const {
+      return array->peek(first + index);
+    }
+
+    bool less(const value_type& a, const value_type& b){
+      return array->less(a, b);
+    }
+
+    void compare(){
+      array->compare();
+    }
+  };
+
+  template <typename Trace, typename T = int, typename Compare = std::less<T>> using Array = TracedArray<T, Trace, Compare>;
+
+  // Algorithms are written once against any TracedArray and instantiated
+  // per trace policy, element type and comparator. Instances only hold
+  // configuration, every run gets its range and works on that alone.
+  template <typename Target> class IAlgo {
+  public:
+    using Range = TracedRange<Target>;
+
+    virtual ~IAlgo() {};
+    virtual void run(Range target, const CancellationToken& token) = 0;
+  };
+
+  template <typename Trace, typename T = int, typename Compare = std::less<T>> inline std::map<std::string, IAlgo<Array<Trace, T, Compare>>*> algos;
+
+  // What an algorithm promises, registered once per name next to its
+  // instances. complexity is the average case; max_n is the largest input
+  // it can be expected to finish at all, harnesses skip it beyond that.
+  enum Property : unsigned { Stable = 1, InPlace = 2, Adaptive = 4 };
+
+  struct Capabilities {
+    unsigned properties = 0;
+    std::string complexity;
+    size_t max_n = std::numeric_limits<size_t>::max();
+
+    bool has(Property property) const {
+      return properties & property;
+    }
+  };
+
+  inline std::map<std::string, Capabilities> capabilities;
   void init();
   void deinit();
-  void run(std::string name);
-  template <typename T> void swap(T &a, T &b);
+
+  template <typename Array> void swap(TracedRef<Array> a, TracedRef<Array> b){
+    a.array.swap(a.index, b.index);
+    typename Array::value_type temp = a;
+    a = b;
+    b = std::move(temp);
+  }
 }
 
 #endif
-
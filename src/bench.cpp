@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "algo.h"
+#include "bench.h"
+#include "clock.h"
+#include "cachesim.h"
+#include "jobs.h"
+#include "generators.h"
+#include "elements.h"
+
+using namespace std;
+
+namespace bench {
+  enum class Format { Table, Csv, Json };
+
+  struct Options {
+    vector<size_t> sizes = {100, 1000};
+    vector<string> algos;
+    vector<string> distributions = {"Uniform random"};
+    vector<string> types = {"int"};
+    size_t k = 0;
+    unsigned seed = 1;
+    int timeout = 10;
+    algo::CostModel costs;
+    vector<algo::CacheConfig> cache;
+    size_t line = 64;
+    vector<unsigned> threads = {max(1u, thread::hardware_concurrency())};
+    size_t arrays = 1;
+    int warmup = 1;
+    int reps = 5;
+    Format format = Format::Table;
+    bool perf = false;
+  };
+
+  static vector<string> split(const string& list){
+    vector<string> parts;
+    stringstream stream(list);
+    string part;
+    while(getline(stream, part, ','))
+      if(!part.empty()) parts.push_back(part);
+    return parts;
+  }
+
+  static void usage(const char* name){
+    fprintf(stderr,
+      "Usage: %s --bench [options]\n"
+      "  --sizes N,N,...     element counts to run (default 100,1000)\n"
+      "  --algos A,B,...     algorithms to run (default all)\n"
+      "  --dist D,D,...      input distributions (default Uniform random, see below)\n"
+      "  --inversions K      swaps for Nearly sorted (default sqrt(size))\n"
+      "  --types T,T,...     element types (default int, see below)\n"
+      "  --seed N            input seed (default 1)\n"
+      "  --timeout S         seconds allowed per run, a cell's runs share them (default 10)\n"
+      "  --costs R,W,C       modelled µs per read, write and compare (default 1,1,1)\n"
+      "  --cache SPEC        simulate caches, e.g. 32K/8,1M/16,8M/16 (size/ways per level)\n"
+      "  --line N            cache line size in bytes (default 64)\n"
+      "  --threads N,N,...   scheduler worker counts to time (default all cores)\n"
+      "  --arrays N          sort N arrays at once per timed run, one thread each (default 1)\n"
+      "  --warmup N          untimed runs before each cell (default 1)\n"
+      "  --reps N            timed runs per cell (default 5)\n"
+      "  --format F          table, csv or json (default table)\n"
+      "  --perf              read hardware counters around timed runs (Linux)\n"
+      "Distributions:",
+      name);
+    const char* separator = " ";
+    for(const pair<string, algo::Generator>& generator : algo::generators()){
+      fprintf(stderr, "%s%s", separator, generator.first.c_str());
+      separator = ", ";
+    }
+    fprintf(stderr, "\nTypes:");
+    separator = " ";
+    for(const string& type : algo::ElementTypes::names()){
+      fprintf(stderr, "%s%s", separator, type.c_str());
+      separator = ", ";
+    }
+    fprintf(stderr, "\n");
+  }
+
+  static bool parse(int argc, char** argv, Options& opts){
+    for(int i = 1; i < argc; i++){
+      string arg = argv[i];
+      bool has_value = i+1 < argc;
+      if(arg == "--bench"){
+        continue;
+      }else if(arg == "--sizes" && has_value){
+        opts.sizes.clear();
+        for(string& s : split(argv[++i])) opts.sizes.push_back(strtoul(s.c_str(), nullptr, 10));
+      }else if(arg == "--algos" && has_value){
+        opts.algos = split(argv[++i]);
+      }else if(arg == "--dist" && has_value){
+        opts.distributions = split(argv[++i]);
+      }else if(arg == "--types" && has_value){
+        opts.types = split(argv[++i]);
+      }else if(arg == "--inversions" && has_value){
+        opts.k = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--seed" && has_value){
+        opts.seed = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--timeout" && has_value){
+        opts.timeout = atoi(argv[++i]);
+      }else if(arg == "--costs" && has_value){
+        vector<string> costs = split(argv[++i]);
+        if(costs.size() != 3){
+          usage(argv[0]);
+          return false;
+        }
+        opts.costs = {atof(costs[0].c_str()), atof(costs[1].c_str()), atof(costs[2].c_str())};
+      }else if(arg == "--cache" && has_value){
+        if(!algo::parse_cache(argv[++i], opts.cache)){
+          usage(argv[0]);
+          return false;
+        }
+      }else if(arg == "--line" && has_value){
+        opts.line = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--warmup" && has_value){
+        opts.warmup = max(0, atoi(argv[++i]));
+      }else if(arg == "--reps" && has_value){
+        opts.reps = max(1, atoi(argv[++i]));
+      }else if(arg == "--format" && has_value){
+        string format = argv[++i];
+        if(format == "table") opts.format = Format::Table;
+        else if(format == "csv") opts.format = Format::Csv;
+        else if(format == "json") opts.format = Format::Json;
+        else{
+          usage(argv[0]);
+          return false;
+        }
+      }else if(arg == "--perf"){
+        opts.perf = true;
+      }else if(arg == "--arrays" && has_value){
+        opts.arrays = max(1l, atol(argv[++i]));
+      }else if(arg == "--threads" && has_value){
+        opts.threads.clear();
+        for(string& s : split(argv[++i])) opts.threads.push_back(max(1ul, strtoul(s.c_str(), nullptr, 10)));
+        if(opts.threads.empty()){
+          usage(argv[0]);
+          return false;
+        }
+      }else{
+        usage(argv[0]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // One timed cell of the matrix, times in µs
+  struct Cell {
+    string name;
+    string distribution;
+    string type;
+    size_t size = 0;
+    unsigned threads = 0;
+    size_t arrays = 1;
+    bool interrupted = false;
+    algo::Verdict verdict = algo::Verdict::Unchecked;
+    double median = 0;
+    double p90 = 0;
+    double stddev = 0;
+    double speedup = 0;
+    double modelled = 0;
+    algo::Counters counters;
+    vector<algo::CacheLevel> levels;
+    algo::PerfSample perf;
+  };
+
+  static void summarize(vector<size_t> times, Cell& cell){
+    cell.median = cell.p90 = cell.stddev = 0;
+    if(times.empty()) return;
+    sort(times.begin(), times.end());
+    size_t n = times.size();
+    cell.median = n % 2 ? times[n/2] : (times[n/2 - 1] + times[n/2]) / 2.0;
+    cell.p90 = times[min(n - 1, (size_t)ceil(0.9 * n) - 1)];
+    double mean = 0;
+    for(size_t time : times) mean += time;
+    mean /= n;
+    double variance = 0;
+    for(size_t time : times) variance += (time - mean) * (time - mean);
+    cell.stddev = n > 1 ? sqrt(variance / (n - 1)) : 0;
+  }
+
+  static double elements_per_second(const Cell& cell){
+    return cell.interrupted || cell.median <= 0 ? 0 : cell.size * cell.arrays / (cell.median / 1e6);
+  }
+
+  // per element over all arrays of a run (counts cover every array
+  // thread), or - when the event could not be counted
+  static string per_element(const Cell& cell, algo::PerfSample::Event event){
+    if(!cell.perf.has(event) || !cell.size) return "-";
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", (double)cell.perf.values[event] / (cell.size * cell.arrays));
+    return buffer;
+  }
+
+  static const char* perf_columns[] = {"branch_misses_per_element", "l1d_misses_per_element", "llc_misses_per_element"};
+  static const algo::PerfSample::Event perf_events[] = {algo::PerfSample::BranchMisses, algo::PerfSample::L1dMisses, algo::PerfSample::LlcMisses};
+
+  static string json_string(const string& value){
+    string quoted = "\"";
+    for(char c : value){
+      if(c == '"' || c == '\\') quoted += '\\';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  static string csv_string(const string& value){
+    if(value.find_first_of(",\"") == string::npos) return value;
+    string quoted = "\"";
+    for(char c : value){
+      if(c == '"') quoted += '"';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  static void header(const Options& opts){
+    if(opts.format == Format::Json){
+      printf("[\n");
+    }else if(opts.format == Format::Csv){
+      printf("algorithm,distribution,type,size,threads,arrays,interrupted,verified,median_us,p90_us,stddev_us,speedup,elements_per_second,modelled_us,comparisons,swaps,writes");
+      for(const algo::CacheConfig& level : opts.cache)
+        printf(",%s_hits,%s_misses", level.name.c_str(), level.name.c_str());
+      if(opts.perf){
+        printf(",ipc");
+        for(const char* column : perf_columns) printf(",%s", column);
+      }
+      printf("\n");
+    }else{
+      printf("%-24s %-16s %-7s %10s %8s %6s %-9s %12s %12s %12s %8s %14s %14s %14s %14s %14s", "algorithm", "distribution", "type", "size", "threads", "arrays",
+        "verified", "median (µs)", "p90 (µs)", "stddev (µs)", "speedup", "elements/s", "modelled (µs)", "comparisons", "swaps", "writes");
+      for(const algo::CacheConfig& level : opts.cache)
+        printf(" %24s", (level.name + " hits/misses").c_str());
+      if(opts.perf)
+        printf(" %6s %14s %14s %14s", "IPC", "br-miss/elem", "L1d-miss/elem", "LLC-miss/elem");
+      printf("\n");
+    }
+  }
+
+  static void emit(const Options& opts, const Cell& cell, bool first){
+    const algo::Counters& counters = cell.counters;
+    if(opts.format == Format::Json){
+      printf("%s  {\"algorithm\": %s, \"distribution\": %s, \"type\": %s, \"size\": %zu, \"threads\": %u, \"arrays\": %zu, \"interrupted\": %s, "
+        "\"verified\": %s, \"median_us\": %.1f, \"p90_us\": %.1f, \"stddev_us\": %.1f, \"speedup\": %.3f, \"elements_per_second\": %.0f, "
+        "\"modelled_us\": %.0f, \"comparisons\": %zu, \"swaps\": %zu, \"writes\": %zu, \"cache\": [",
+        first ? "" : ",\n", json_string(cell.name).c_str(), json_string(cell.distribution).c_str(), json_string(cell.type).c_str(), cell.size, cell.threads, cell.arrays,
+        cell.interrupted ? "true" : "false", json_string(algo::verdict_name(cell.verdict)).c_str(), cell.median, cell.p90, cell.stddev, cell.speedup, elements_per_second(cell),
+        cell.modelled, counters.comparisons, counters.swaps, counters.writes);
+      for(size_t i = 0; i < cell.levels.size(); i++)
+        printf("%s{\"level\": %s, \"hits\": %zu, \"misses\": %zu}", i ? ", " : "", json_string(cell.levels[i].config.name).c_str(),
+          cell.levels[i].stats.hits, cell.levels[i].stats.misses);
+      printf("]");
+      if(opts.perf){
+        bool ipc = cell.perf.has(algo::PerfSample::Cycles) && cell.perf.has(algo::PerfSample::Instructions);
+        printf(", \"ipc\": %s", ipc ? to_string(cell.perf.ipc()).c_str() : "null");
+        for(size_t i = 0; i < 3; i++){
+          string value = per_element(cell, perf_events[i]);
+          printf(", \"%s\": %s", perf_columns[i], value == "-" ? "null" : value.c_str());
+        }
+      }
+      printf("}");
+    }else if(opts.format == Format::Csv){
+      printf("%s,%s,%s,%zu,%u,%zu,%d,%s,%.1f,%.1f,%.1f,%.3f,%.0f,%.0f,%zu,%zu,%zu", csv_string(cell.name).c_str(), csv_string(cell.distribution).c_str(), cell.type.c_str(),
+        cell.size, cell.threads, cell.arrays, cell.interrupted, algo::verdict_name(cell.verdict), cell.median, cell.p90, cell.stddev, cell.speedup, elements_per_second(cell),
+        cell.modelled, counters.comparisons, counters.swaps, counters.writes);
+      for(const algo::CacheLevel& level : cell.levels)
+        printf(",%zu,%zu", level.stats.hits, level.stats.misses);
+      if(opts.perf){
+        bool ipc = cell.perf.has(algo::PerfSample::Cycles) && cell.perf.has(algo::PerfSample::Instructions);
+        printf(",%s", ipc ? to_string(cell.perf.ipc()).c_str() : "");
+        for(algo::PerfSample::Event event : perf_events){
+          string value = per_element(cell, event);
+          printf(",%s", value == "-" ? "" : value.c_str());
+        }
+      }
+      printf("\n");
+    }else{
+      string median = cell.interrupted ? "timeout" : to_string((size_t)cell.median);
+      string speedup = cell.interrupted || !cell.speedup ? "-" : to_string(cell.speedup).substr(0, 4);
+      printf("%-24s %-16s %-7s %10zu %8u %6zu %-9s %12s %12.0f %12.1f %8s %14.0f %14.0f %14zu %14zu %14zu", cell.name.c_str(), cell.distribution.c_str(), cell.type.c_str(),
+        cell.size, cell.threads, cell.arrays, algo::verdict_name(cell.verdict), median.c_str(), cell.p90, cell.stddev, speedup.c_str(), elements_per_second(cell),
+        cell.modelled, counters.comparisons, counters.swaps, counters.writes);
+      for(const algo::CacheLevel& level : cell.levels)
+        printf(" %24s", (to_string(level.stats.hits) + "/" + to_string(level.stats.misses)).c_str());
+      if(opts.perf){
+        bool ipc = cell.perf.has(algo::PerfSample::Cycles) && cell.perf.has(algo::PerfSample::Instructions);
+        printf(" %6s", ipc ? to_string(cell.perf.ipc()).substr(0, 4).c_str() : "-");
+        for(algo::PerfSample::Event event : perf_events)
+          printf(" %14s", per_element(cell, event).c_str());
+      }
+      printf("\n");
+    }
+  }
+
+  static void footer(const Options& opts){
+    if(opts.format == Format::Json) printf("\n]\n");
+  }
+
+  int main(int argc, char** argv){
+    Options opts;
+    if(!parse(argc, argv, opts)) return 1;
+
+    if(opts.algos.empty())
+      for(pair<const string, algo::IAlgo<algo::Array<algo::NoTrace>>*>& a : algo::algos<algo::NoTrace>) opts.algos.push_back(a.first);
+
+    for(string& name : opts.algos){
+      if(!algo::algos<algo::NoTrace>.count(name)){
+        fprintf(stderr, "Unknown algorithm %s\n", name.c_str());
+        return 1;
+      }
+    }
+
+    vector<string> types = algo::ElementTypes::names();
+    for(string& type : opts.types){
+      if(find(types.begin(), types.end(), type) == types.end()){
+        fprintf(stderr, "Unknown element type %s\n", type.c_str());
+        return 1;
+      }
+    }
+
+    vector<int> probe;
+    for(string& name : opts.distributions){
+      if(!algo::generate(name, 0, 0, 0, probe)){
+        fprintf(stderr, "Unknown distribution %s\n", name.c_str());
+        return 1;
+      }
+    }
+
+    // every cell is timed from untraced runs (warmups discarded), speedup
+    // is against the first thread count; counts come from a single counting
+    // run, which is also the one verified. The whole matrix is queued up
+    // front and runs back to back on one job thread, one job per cell and
+    // thread count covering its warmups and reps.
+    struct Row {
+      string name;
+      string distribution;
+      string type;
+      size_t size;
+      future<algo::SortResult> counted;
+      future<algo::SortResult> cached;
+      vector<pair<unsigned, future<algo::SortResult>>> timed;
+    };
+
+    algo::JobQueue jobs;
+    auto submit = [&](algo::SortJob job){
+      return jobs.submit([job](const algo::CancellationToken& token){ return algo::run_job(job, token); }, opts.timeout * (job.warmup + job.reps));
+    };
+
+    vector<Row> rows;
+    for(string& name : opts.algos){
+      const algo::Capabilities& promises = algo::capabilities[name];
+      for(size_t size : opts.sizes){
+        if(size > promises.max_n){
+          fprintf(stderr, "Skipping %s above %zu elements\n", name.c_str(), promises.max_n);
+          break;
+        }
+      }
+      for(string& type : opts.types){
+        // radix sorts only exist for key-like types
+        if(!algo::supports(name, type)) continue;
+        for(string& distribution : opts.distributions){
+          for(size_t size : opts.sizes){
+            // it would only run into the timeout
+            if(size > promises.max_n) continue;
+            algo::SortJob job;
+            job.algorithm = name;
+            job.type = type;
+            job.distribution = distribution;
+            job.size = size;
+            job.k = opts.k;
+            job.seed = opts.seed;
+            job.cache = opts.cache;
+            job.line = opts.line;
+            job.perf = opts.perf;
+            job.arrays = opts.arrays;
+
+            Row row;
+            row.name = name;
+            row.type = type;
+            row.distribution = distribution;
+            row.size = size;
+            job.threads = opts.threads[0];
+            job.tracing = algo::Tracing::Counting;
+            job.verify = true;
+            row.counted = submit(job);
+            job.verify = false;
+            if(!opts.cache.empty()){
+              job.tracing = algo::Tracing::Cache;
+              row.cached = submit(job);
+            }
+            job.tracing = algo::Tracing::None;
+            job.warmup = opts.warmup;
+            job.reps = opts.reps;
+            for(unsigned threads : opts.threads){
+              job.threads = threads;
+              row.timed.emplace_back(threads, submit(job));
+            }
+            rows.push_back(move(row));
+          }
+        }
+      }
+    }
+
+    header(opts);
+    bool first = true;
+    bool warned = false;
+    bool failed = false;
+    for(Row& row : rows){
+      Cell cell;
+      cell.name = row.name;
+      cell.distribution = row.distribution;
+      cell.type = row.type;
+      cell.size = row.size;
+      cell.arrays = opts.arrays;
+      algo::SortResult counted = row.counted.get();
+      cell.counters = counted.counters;
+      cell.verdict = counted.verdict;
+      if(cell.verdict != algo::Verdict::Sorted && cell.verdict != algo::Verdict::Unchecked){
+        fprintf(stderr, "%s failed verification on %zu %s %s: %s\n", cell.name.c_str(), cell.size, cell.distribution.c_str(), cell.type.c_str(),
+          algo::verdict_name(cell.verdict));
+        failed = true;
+      }
+      cell.modelled = opts.costs.time(cell.counters);
+      if(row.cached.valid()) cell.levels = row.cached.get().levels;
+
+      double baseline = 0;
+      for(pair<unsigned, future<algo::SortResult>>& run : row.timed){
+        algo::SortResult result = run.second.get();
+        vector<size_t>& times = result.times;
+        cell.interrupted = result.interrupted || times.size() < (size_t)opts.reps;
+        cell.perf = result.perf;
+        // counters are summed over the timed runs, report the mean
+        for(uint64_t& value : cell.perf.values) value /= max((size_t)1, times.size());
+        if(opts.perf && !warned && !cell.perf.has(algo::PerfSample::Cycles)){
+          fprintf(stderr, "Hardware counters unavailable (check perf_event_paranoid), reporting -\n");
+          warned = true;
+        }
+        cell.threads = run.first;
+        summarize(times, cell);
+        if(!baseline && !cell.interrupted) baseline = max(1.0, cell.median);
+        cell.speedup = cell.interrupted || !baseline ? 0 : baseline / max(1.0, cell.median);
+
+        emit(opts, cell, first);
+        first = false;
+        fflush(stdout);
+      }
+    }
+    footer(opts);
+
+    return failed ? 1 : 0;
+  }
+}
@@ -0,0 +1,8 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+namespace bench {
+  int main(int argc, char** argv);
+}
+
+#endif
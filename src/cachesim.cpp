@@ -0,0 +1,91 @@
+#include <stdlib.h>
+#include <sstream>
+#include <algorithm>
+
+#include "cachesim.h"
+
+using namespace std;
+
+namespace algo {
+  CacheLevel::CacheLevel(const CacheConfig& config, size_t line) : config(config) {
+    ways = config.ways ? config.ways : 1;
+    sets = config.size / (line * ways);
+    if(!sets) sets = 1;
+    tags.assign(sets * ways, UINT64_MAX);
+    used.assign(sets * ways, 0);
+  }
+
+  bool CacheLevel::access(uint64_t line){
+    size_t base = (line % sets) * ways;
+    size_t victim = base;
+    tick++;
+    for(size_t i = base; i < base + ways; i++){
+      if(tags[i] == line){
+        used[i] = tick;
+        stats.hits++;
+        return true;
+      }
+      if(used[i] < used[victim]) victim = i;
+    }
+    tags[victim] = line;
+    used[victim] = tick;
+    stats.misses++;
+    return false;
+  }
+
+  void CacheLevel::clear(){
+    fill(tags.begin(), tags.end(), UINT64_MAX);
+    fill(used.begin(), used.end(), 0);
+    stats = CacheStats();
+  }
+
+  CacheSim::CacheSim(){
+    configure({{"L1", 32 << 10, 8}, {"L2", 1 << 20, 16}, {"LLC", 8 << 20, 16}}, 64);
+  }
+
+  void CacheSim::configure(const vector<CacheConfig>& configs, size_t line){
+    shift = 0;
+    while(((size_t)1 << (shift+1)) <= line) shift++;
+    levels.clear();
+    for(const CacheConfig& config : configs)
+      levels.emplace_back(config, (size_t)1 << shift);
+  }
+
+  void CacheSim::reset_stats(){
+    for(CacheLevel& level : levels)
+      level.stats = CacheStats();
+  }
+
+  void CacheSim::clear(){
+    for(CacheLevel& level : levels)
+      level.clear();
+  }
+
+  static size_t parse_size(const string& s){
+    char* end;
+    size_t size = strtoul(s.c_str(), &end, 10);
+    switch(*end){
+      case 'K': case 'k': return size << 10;
+      case 'M': case 'm': return size << 20;
+      case 'G': case 'g': return size << 30;
+      default: return size;
+    }
+  }
+
+  bool parse_cache(const string& spec, vector<CacheConfig>& configs){
+    static const char* names[] = {"L1", "L2", "L3", "L4"};
+    configs.clear();
+    stringstream stream(spec);
+    string level;
+    while(getline(stream, level, ',')){
+      size_t slash = level.find('/');
+      if(slash == string::npos || configs.size() == 4) return false;
+      CacheConfig config = {names[configs.size()], parse_size(level.substr(0, slash)), strtoul(level.c_str() + slash + 1, nullptr, 10)};
+      if(!config.size || !config.ways) return false;
+      configs.push_back(config);
+    }
+    if(configs.empty()) return false;
+    configs.back().name = "LLC";
+    return true;
+  }
+}
@@ -0,0 +1,76 @@
+#ifndef CACHESIM_H
+#define CACHESIM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace algo {
+  struct CacheConfig {
+    std::string name;
+    size_t size;
+    size_t ways;
+  };
+
+  struct CacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+  };
+
+  // One set-associative level with LRU replacement
+  class CacheLevel {
+    std::vector<uint64_t> tags;
+    std::vector<uint64_t> used;
+    size_t sets;
+    size_t ways;
+    uint64_t tick = 0;
+
+  public:
+    CacheConfig config;
+    CacheStats stats;
+
+    CacheLevel(const CacheConfig& config, size_t line);
+    bool access(uint64_t line);
+    void clear();
+  };
+
+  // Inclusive hierarchy; an access walks down the levels until one hits and
+  // fills every level that missed
+  class CacheSim {
+    unsigned shift = 6;
+    SpinLock lock;
+
+  public:
+    std::vector<CacheLevel> levels;
+
+    CacheSim();
+    void configure(const std::vector<CacheConfig>& configs, size_t line);
+    void reset_stats();
+    void clear();
+
+    void access(uint64_t address){
+      std::lock_guard<SpinLock> guard(lock);
+      uint64_t tag = address >> shift;
+      for(CacheLevel& level : levels)
+        if(level.access(tag)) return;
+    }
+  };
+
+  // "32K/8,1M/16,8M/16" -> L1, L2, LLC; false on malformed specs
+  bool parse_cache(const std::string& spec, std::vector<CacheConfig>& configs);
+
+  template <typename T> struct CacheTrace {
+    CacheSim* sim = nullptr;
+
+    void read(size_t index){ sim->access(index * sizeof(T)); }
+    void write(size_t index, const T& old_value, const T& value){ sim->access(index * sizeof(T)); }
+    void compare(){}
+    void swap(size_t a, size_t b){}
+  };
+}
+
+#endif
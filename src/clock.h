@@ -0,0 +1,77 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+
+#include "trace.h"
+
+namespace algo {
+  // Modelled cost of each kind of access, in microseconds
+  struct CostModel {
+    double read = 1;
+    double write = 1;
+    double compare = 1;
+
+    template <typename T> double cost(const Access<T>& access) const {
+      switch(access.kind){
+        case Access<T>::Read: return read;
+        case Access<T>::Write: return write;
+        case Access<T>::Compare: return compare;
+        default: return 0;
+      }
+    }
+
+    double time(const Counters& counters) const {
+      return counters.reads * read + counters.writes * write + counters.comparisons * compare;
+    }
+  };
+
+  // Time accumulated from a cost model instead of measured, so it does not
+  // depend on host load. Advanced by one thread, readable from any.
+  class VirtualClock {
+    std::atomic<double> elapsed{0};
+
+    void advance(double us){
+      elapsed.store(elapsed.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    }
+
+  public:
+    CostModel model;
+
+    void read(){ advance(model.read); }
+    void write(){ advance(model.write); }
+    void compare(){ advance(model.compare); }
+
+    double now() const {
+      return elapsed.load(std::memory_order_relaxed);
+    }
+
+    void reset(){
+      elapsed.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  // Budget of modelled time refilled from wall time, used to pace playback
+  class Pacer {
+    double budget = 0;
+
+  public:
+    // scale is modelled seconds per wall second
+    void refill(double wall_seconds, double scale){
+      budget += wall_seconds * 1e6 * scale;
+    }
+
+    bool spend(double us){
+      if(us > budget) return false;
+      budget -= us;
+      return true;
+    }
+
+    // nothing left to play, don't bank time for a burst later
+    void idle(){
+      budget = 0;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef ELEMENTS_H
+#define ELEMENTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace algo {
+  // Fixed-width record ordered by its key; the payload only has to travel
+  // along, which is what makes sorting wide records expensive
+  template <size_t Bytes> struct Record {
+    static_assert(Bytes >= 16 && Bytes % 8 == 0, "records are whole words with room for a payload");
+    uint64_t key;
+    uint64_t payload[Bytes / 8 - 1];
+
+    friend bool operator<(const Record& a, const Record& b){ return a.key < b.key; }
+  };
+
+  // A key and where it came from, for sorting an index instead of records
+  struct KeyIndex {
+    uint64_t key;
+    uint32_t index;
+
+    friend bool operator<(const KeyIndex& a, const KeyIndex& b){ return a.key < b.key; }
+  };
+
+  // Per element type: its name on the command line, how to make one from a
+  // generated int (keeping the order), a hash of the whole element for
+  // fingerprinting and, for types the radix sorts can handle, an unsigned
+  // key with the same ordering. Types that carry their input position
+  // return it as tag(), which is what stability is checked against.
+  template <typename T> struct ElementTraits;
+
+  template <> struct ElementTraits<int> {
+    static constexpr const char* name = "int";
+    static int make(int value, size_t){ return value; }
+    static uint64_t hash(int value){ return (uint32_t)value; }
+    using Key = uint32_t;
+    static Key key(int value){ return (uint32_t)value ^ 0x80000000u; }
+  };
+
+  template <> struct ElementTraits<uint64_t> {
+    static constexpr const char* name = "u64";
+    static uint64_t make(int value, size_t){ return (uint64_t)((int64_t)value - INT32_MIN); }
+    static uint64_t hash(uint64_t value){ return value; }
+    using Key = uint64_t;
+    static Key key(uint64_t value){ return value; }
+  };
+
+  template <> struct ElementTraits<double> {
+    static constexpr const char* name = "double";
+    static double make(int value, size_t){ return value; }
+    static uint64_t hash(double value){
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      return bits;
+    }
+    using Key = uint64_t;
+    // negative values flip entirely, positive ones only their sign bit
+    static Key key(double value){
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      return bits >> 63 ? ~bits : bits | (1ull << 63);
+    }
+  };
+
+  template <> struct ElementTraits<std::string> {
+    static constexpr const char* name = "string";
+    // zero padded to a fixed width so the strings order like the values;
+    // generated values are positive
+    static std::string make(int value, size_t){
+      char buffer[16];
+      snprintf(buffer, sizeof(buffer), "%010d", value);
+      return buffer;
+    }
+    static uint64_t hash(const std::string& value){ return std::hash<std::string>()(value); }
+  };
+
+  template <size_t Bytes> struct ElementTraits<Record<Bytes>> {
+    static constexpr const char* name = Bytes == 16 ? "rec16" : Bytes == 64 ? "rec64" : "record";
+    static Record<Bytes> make(int value, size_t index){
+      Record<Bytes> record;
+      record.key = ElementTraits<uint64_t>::make(value, index);
+      for(uint64_t& word : record.payload) word = index;
+      return record;
+    }
+    static uint64_t hash(const Record<Bytes>& record){
+      uint64_t h = record.key;
+      for(uint64_t word : record.payload) h = h * 0x9e3779b97f4a7c15ull + word;
+      return h;
+    }
+    static size_t tag(const Record<Bytes>& record){ return record.payload[0]; }
+    using Key = uint64_t;
+    static Key key(const Record<Bytes>& record){ return record.key; }
+  };
+
+  template <> struct ElementTraits<KeyIndex> {
+    static constexpr const char* name = "pair";
+    static KeyIndex make(int value, size_t index){ return {ElementTraits<uint64_t>::make(value, index), (uint32_t)index}; }
+    static uint64_t hash(const KeyIndex& pair){ return pair.key * 0x9e3779b97f4a7c15ull + pair.index; }
+    static size_t tag(const KeyIndex& pair){ return pair.index; }
+    using Key = uint64_t;
+    static Key key(const KeyIndex& pair){ return pair.key; }
+  };
+
+  template <typename T, typename = void> struct HasRadixKey : std::false_type {};
+  template <typename T> struct HasRadixKey<T, std::void_t<typename ElementTraits<T>::Key>> : std::true_type {};
+
+  template <typename T, typename = void> struct HasTag : std::false_type {};
+  template <typename T> struct HasTag<T, std::void_t<decltype(ElementTraits<T>::tag(std::declval<const T&>()))>> : std::true_type {};
+
+  template <typename T> void make_elements(const std::vector<int>& values, std::vector<T>& elements){
+    elements.resize(values.size());
+    for(size_t i = 0; i < values.size(); i++) elements[i] = ElementTraits<T>::make(values[i], i);
+  }
+
+  template <typename T> struct ElementTag {
+    using type = T;
+  };
+
+  // Every element type the engine is built for, int first
+  template <typename... Ts> struct ElementTypeList {
+    static std::vector<std::string> names(){
+      return {ElementTraits<Ts>::name...};
+    }
+
+    // calls f with an ElementTag for every type
+    template <typename F> static void each(F&& f){
+      (f(ElementTag<Ts>()), ...);
+    }
+
+    // calls f with the ElementTag of the type called name
+    template <typename F> static bool visit(const std::string& name, F&& f){
+      bool found = false;
+      ((!found && name == ElementTraits<Ts>::name ? (f(ElementTag<Ts>()), found = true) : false), ...);
+      return found;
+    }
+  };
+
+  using ElementTypes = ElementTypeList<int, uint64_t, double, std::string, Record<16>, Record<64>, KeyIndex>;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include <cmath>
+#include <algorithm>
+
+#include "generators.h"
+
+using namespace std;
+
+namespace algo {
+  static void ascending(vector<int>& values){
+    for(size_t i = 0; i < values.size(); i++) values[i] = i+1;
+  }
+
+  static void uniform(vector<int>& values, size_t k, default_random_engine& rng){
+    ascending(values);
+    shuffle(values.begin(), values.end(), rng);
+  }
+
+  static void sorted(vector<int>& values, size_t k, default_random_engine& rng){
+    ascending(values);
+  }
+
+  static void reversed(vector<int>& values, size_t k, default_random_engine& rng){
+    for(size_t i = 0; i < values.size(); i++) values[i] = values.size() - i;
+  }
+
+  // k random adjacent swaps, each adds at most one inversion; k = 0 picks sqrt(size)
+  static void nearlySorted(vector<int>& values, size_t k, default_random_engine& rng){
+    ascending(values);
+    if(values.size() < 2) return;
+    if(!k) k = sqrt(values.size());
+    uniform_int_distribution<size_t> position(0, values.size() - 2);
+    for(size_t i = 0; i < k; i++){
+      size_t p = position(rng);
+      std::swap(values[p], values[p+1]);
+    }
+  }
+
+  // 8 distinct values spread over the range
+  static void fewUnique(vector<int>& values, size_t k, default_random_engine& rng){
+    size_t size = values.size();
+    uniform_int_distribution<size_t> bucket(1, 8);
+    for(int& value : values) value = max((size_t)1, bucket(rng) * size / 8);
+  }
+
+  static void organPipe(vector<int>& values, size_t k, default_random_engine& rng){
+    size_t size = values.size();
+    for(size_t i = 0; i < size; i++) values[i] = 1 + 2 * min(i, size - 1 - i);
+  }
+
+  // 16 ascending runs
+  static void sawtooth(vector<int>& values, size_t k, default_random_engine& rng){
+    size_t size = values.size();
+    size_t run = max((size_t)1, size / 16);
+    for(size_t i = 0; i < size; i++) values[i] = 1 + (i % run) * 16;
+  }
+
+  // rank r drawn with probability proportional to 1/r
+  static void zipf(vector<int>& values, size_t k, default_random_engine& rng){
+    size_t size = values.size();
+    vector<double> cumulative(size);
+    double total = 0;
+    for(size_t r = 0; r < size; r++){
+      total += 1.0 / (r+1);
+      cumulative[r] = total;
+    }
+    uniform_real_distribution<double> draw(0, total);
+    for(int& value : values)
+      value = 1 + min(size - 1, (size_t)(lower_bound(cumulative.begin(), cumulative.end(), draw(rng)) - cumulative.begin()));
+  }
+
+  // half of all elements share the median value, the rest are uniform
+  static void duplicateHeavy(vector<int>& values, size_t k, default_random_engine& rng){
+    size_t size = values.size();
+    uniform_int_distribution<int> any(1, max((size_t)1, size));
+    bernoulli_distribution duplicate(0.5);
+    for(int& value : values) value = duplicate(rng) ? (size+1) / 2 : any(rng);
+  }
+
+  const vector<pair<string, Generator>>& generators(){
+    static const vector<pair<string, Generator>> all = {
+      {"Uniform random", uniform},
+      {"Sorted", sorted},
+      {"Reverse", reversed},
+      {"Nearly sorted", nearlySorted},
+      {"Few unique", fewUnique},
+      {"Organ pipe", organPipe},
+      {"Sawtooth", sawtooth},
+      {"Zipf", zipf},
+      {"Duplicate heavy", duplicateHeavy},
+    };
+    return all;
+  }
+
+  bool generate(const string& name, size_t size, size_t k, unsigned seed, vector<int>& values){
+    for(const pair<string, Generator>& generator : generators()){
+      if(generator.first != name) continue;
+      default_random_engine rng(seed);
+      values.resize(size);
+      generator.second(values, k, rng);
+      return true;
+    }
+    return false;
+  }
+}
@@ -0,0 +1,25 @@
+#ifndef GENERATORS_H
+#define GENERATORS_H
+
+#include <cstddef>
+#include <functional>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace algo {
+  // Fills an already sized vector with one input distribution, values in
+  // 1..size so they double as bar heights. k only matters where a
+  // distribution has a knob (inversions for nearly sorted).
+  using Generator = std::function<void(std::vector<int>& values, size_t k, std::default_random_engine& rng)>;
+
+  // All distributions by name, in menu order
+  const std::vector<std::pair<std::string, Generator>>& generators();
+
+  // Fills values straight into plain storage, nothing is traced. Returns
+  // false for an unknown name.
+  bool generate(const std::string& name, size_t size, size_t k, unsigned seed, std::vector<int>& values);
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include <stdio.h>
+
+#include "bars.h"
+
+using namespace std;
+
+namespace gui {
+  static const char* vertex_shader =
+    "#version 330 core\n"
+    "layout(location = 0) in int value;\n"
+    "layout(location = 1) in uint color;\n"
+    "layout(location = 2) in int low;\n"
+    "uniform int count;\n"
+    "uniform float max_value;\n"
+    "uniform vec2 size;\n"
+    "uniform sampler2D palette;\n"
+    "out vec4 tint;\n"
+    "void main(){\n"
+    "  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+    "  float bar = size.x / float(count);\n"
+    "  float width = bar > 2.0 ? bar - 1.0 : bar;\n"
+    "  float x = float(gl_InstanceID) * bar + corner.x * width;\n"
+    "  float y = size.y * mix(float(low), float(value), corner.y) / max_value;\n"
+    "  gl_Position = vec4(x / size.x * 2.0 - 1.0, y / size.y * 2.0 - 1.0, 0.0, 1.0);\n"
+    "  tint = texelFetch(palette, ivec2(int(color), 0), 0);\n"
+    "}\n";
+
+  static const char* fragment_shader =
+    "#version 330 core\n"
+    "in vec4 tint;\n"
+    "out vec4 out_color;\n"
+    "void main(){\n"
+    "  out_color = tint;\n"
+    "}\n";
+
+  static GLuint compile(GLenum type, const char* source){
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if(status != GL_TRUE){
+      char log[1024];
+      glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+      fprintf(stderr, "[GL] Bar shader failed to compile: %s\n", log);
+      glDeleteShader(shader);
+      return 0;
+    }
+    return shader;
+  }
+
+  bool BarRenderer::init(){
+    GLuint vert = compile(GL_VERTEX_SHADER, vertex_shader);
+    GLuint frag = compile(GL_FRAGMENT_SHADER, fragment_shader);
+    if(!vert || !frag) return false;
+
+    program = glCreateProgram();
+    glAttachShader(program, vert);
+    glAttachShader(program, frag);
+    glLinkProgram(program);
+    glDeleteShader(vert);
+    glDeleteShader(frag);
+    GLint status;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if(status != GL_TRUE){
+      fprintf(stderr, "[GL] Bar shader failed to link\n");
+      return false;
+    }
+    count_location = glGetUniformLocation(program, "count");
+    max_value_location = glGetUniformLocation(program, "max_value");
+    size_location = glGetUniformLocation(program, "size");
+
+    // one value and one color per instance
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &values_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, values_buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 1, GL_INT, 0, nullptr);
+    glVertexAttribDivisor(0, 1);
+    glGenBuffers(1, &colors_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, colors_buffer);
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_BYTE, 0, nullptr);
+    glVertexAttribDivisor(1, 1);
+    glGenBuffers(1, &lows_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, lows_buffer);
+    glVertexAttribIPointer(2, 1, GL_INT, 0, nullptr);
+    glVertexAttribDivisor(2, 1);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &palette_texture);
+    glBindTexture(GL_TEXTURE_2D, palette_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 256, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+  }
+
+  void BarRenderer::destroy(){
+    glDeleteTextures(1, &palette_texture);
+    glDeleteBuffers(1, &lows_buffer);
+    glDeleteBuffers(1, &colors_buffer);
+    glDeleteBuffers(1, &values_buffer);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteProgram(program);
+    program = vao = values_buffer = colors_buffer = lows_buffer = palette_texture = 0;
+  }
+
+  void BarRenderer::palette(const uint8_t (&rgba)[256][4]){
+    glBindTexture(GL_TEXTURE_2D, palette_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  void BarRenderer::draw(const vector<int>& values, const vector<uint8_t>& colors, int max_value, int x, int y, int width, int height,
+    const vector<int>* lows){
+    if(!program || values.empty() || colors.size() < values.size() || width <= 0 || height <= 0) return;
+    if(lows && lows->size() < values.size()) return;
+
+    // orphan and refill, the driver doesn't have to wait for last frame's draw
+    glBindBuffer(GL_ARRAY_BUFFER, values_buffer);
+    glBufferData(GL_ARRAY_BUFFER, values.size() * sizeof(int), values.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, colors_buffer);
+    glBufferData(GL_ARRAY_BUFFER, values.size(), colors.data(), GL_STREAM_DRAW);
+    if(lows){
+      glBindBuffer(GL_ARRAY_BUFFER, lows_buffer);
+      glBufferData(GL_ARRAY_BUFFER, values.size() * sizeof(int), lows->data(), GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glViewport(x, y, width, height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, width, height);
+    glEnable(GL_BLEND);
+    glBlendEquation(GL_FUNC_ADD);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glUseProgram(program);
+    glUniform1i(count_location, values.size());
+    glUniform1f(max_value_location, max_value > 0 ? max_value : 1);
+    glUniform2f(size_location, width, height);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, palette_texture);
+    glBindVertexArray(vao);
+    // without lows the attribute reads its constant 0
+    if(lows) glEnableVertexAttribArray(2);
+    else{
+      glDisableVertexAttribArray(2);
+      glVertexAttribI4i(2, 0, 0, 0, 0);
+    }
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, values.size());
+
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+  }
+}
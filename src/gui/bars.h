@@ -0,0 +1,39 @@
+#ifndef GUI_BARS_H
+#define GUI_BARS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+namespace gui {
+  // Bar chart drawn in a single instanced call. The values and one color
+  // byte per bar are uploaded as they are every frame; the vertex shader
+  // builds each bar's quad from gl_InstanceID and looks its color up in a
+  // 256 entry palette texture. Needs a GL 3.3 core context.
+  class BarRenderer {
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint values_buffer = 0;
+    GLuint colors_buffer = 0;
+    GLuint lows_buffer = 0;
+    GLuint palette_texture = 0;
+    GLint count_location = -1;
+    GLint max_value_location = -1;
+    GLint size_location = -1;
+
+  public:
+    bool init();
+    void destroy();
+
+    // 256 RGBA entries, indexed by the color bytes passed to draw()
+    void palette(const uint8_t (&rgba)[256][4]);
+
+    // Draws into the given framebuffer rectangle, origin bottom left. Bars
+    // start at 0, or at lows when given (for min/max ranges).
+    void draw(const std::vector<int>& values, const std::vector<uint8_t>& colors, int max_value, int x, int y, int width, int height,
+      const std::vector<int>* lows = nullptr);
+  };
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include <algorithm>
+
+#include "decimate.h"
+
+using namespace std;
+
+namespace gui {
+  void ColumnDecimator::rebuild(const vector<int>& values, size_t count){
+    elements = values.size();
+    columns = min(count, elements);
+    sums.assign(columns, 0);
+    mins.assign(columns, 0);
+    maxs.assign(columns, 0);
+    means.assign(columns, 0);
+    touched.assign(columns, 0);
+    dirty.assign(columns, 1);
+    dirty_list.clear();
+    for(size_t c = 0; c < columns; c++) dirty_list.push_back(c);
+    flush(values);
+  }
+
+  void ColumnDecimator::flush(const vector<int>& values){
+    for(size_t c : dirty_list){
+      size_t end = c + 1 < columns ? begin(c + 1) : elements;
+      int low = values[begin(c)];
+      int high = low;
+      int64_t sum = 0;
+      for(size_t i = begin(c); i < end; i++){
+        low = min(low, values[i]);
+        high = max(high, values[i]);
+        sum += values[i];
+      }
+      mins[c] = low;
+      maxs[c] = high;
+      sums[c] = sum;
+      dirty[c] = 0;
+    }
+    dirty_list.clear();
+
+    for(size_t c = 0; c < columns; c++){
+      size_t end = c + 1 < columns ? begin(c + 1) : elements;
+      means[c] = sums[c] / (int64_t)(end - begin(c));
+    }
+  }
+
+  void ColumnDecimator::clear_touched(){
+    fill(touched.begin(), touched.end(), 0);
+  }
+}
@@ -0,0 +1,73 @@
+#ifndef GUI_DECIMATE_H
+#define GUI_DECIMATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gui {
+  // Reduces an array wider than the chart to one min/max/mean triple per
+  // pixel column. Writes update their column in O(1); only a write that
+  // replaces a column's current min or max marks it for a rescan, done
+  // once per frame in flush(). Columns also keep the highest touch code of
+  // their elements since the last clear_touched().
+  class ColumnDecimator {
+    size_t elements = 0;
+    size_t columns = 0;
+    std::vector<int64_t> sums;
+    std::vector<uint8_t> dirty;
+    std::vector<size_t> dirty_list;
+
+    size_t begin(size_t column) const {
+      return (column * elements + columns - 1) / columns;
+    }
+
+  public:
+    std::vector<int> mins;
+    std::vector<int> maxs;
+    std::vector<int> means;
+    std::vector<uint8_t> touched;
+
+    // only worth it when there are more elements than columns
+    bool active() const {
+      return columns && elements > columns;
+    }
+
+    size_t size() const {
+      return columns;
+    }
+
+    size_t column(size_t index) const {
+      return index * columns / elements;
+    }
+
+    // resizes and recomputes everything from values
+    void rebuild(const std::vector<int>& values, size_t columns);
+
+    void write(size_t index, int old_value, int value){
+      size_t c = column(index);
+      sums[c] += (int64_t)value - old_value;
+      if(value <= mins[c]) mins[c] = value;
+      else if(old_value == mins[c]) mark(c);
+      if(value >= maxs[c]) maxs[c] = value;
+      else if(old_value == maxs[c]) mark(c);
+    }
+
+    void touch(size_t index, uint8_t code){
+      uint8_t& t = touched[column(index)];
+      if(code > t) t = code;
+    }
+
+    void mark(size_t c){
+      if(dirty[c]) return;
+      dirty[c] = 1;
+      dirty_list.push_back(c);
+    }
+
+    // rescans the columns that lost their min or max and refreshes means
+    void flush(const std::vector<int>& values);
+    void clear_touched();
+  };
+}
+
+#endif
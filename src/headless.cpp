@@ -0,0 +1,15 @@
+#include <string.h>
+
+#include "algo.h"
+#include "bench.h"
+#include "video.h"
+
+int main(int argc, char** argv){
+  algo::init();
+  bool export_video = false;
+  for(int i = 1; i < argc; i++)
+    if(!strcmp(argv[i], "--export")) export_video = true;
+  int ret = export_video ? video::main(argc, argv) : bench::main(argc, argv);
+  algo::deinit();
+  return ret;
+}
@@ -0,0 +1,301 @@
+#include <algorithm>
+
+#include "jobs.h"
+#include "scheduler.h"
+#include "generators.h"
+#include "elements.h"
+
+using namespace std;
+
+namespace algo {
+  JobQueue::JobQueue(unsigned count){
+    if(count < 1) count = 1;
+    active.resize(count);
+    for(size_t i = 0; i < count; i++)
+      workers.emplace_back(&JobQueue::work, this, i);
+    watchdog = thread(&JobQueue::watch, this);
+  }
+
+  JobQueue::~JobQueue(){
+    cancel();
+    {
+      lock_guard<mutex> lock(queue_mutex);
+      stopping = true;
+    }
+    work_cv.notify_all();
+    watchdog_cv.notify_all();
+    for(thread& t : workers) t.join();
+    watchdog.join();
+  }
+
+  void JobQueue::enqueue(function<void(const CancellationToken&)> fn, double timeout){
+    shared_ptr<Job> job(new Job());
+    job->fn = move(fn);
+    job->timeout = timeout;
+    {
+      lock_guard<mutex> lock(queue_mutex);
+      queue.push_back(job);
+    }
+    work_cv.notify_one();
+  }
+
+  void JobQueue::cancel(){
+    lock_guard<mutex> lock(queue_mutex);
+    for(shared_ptr<Job>& job : queue) job->token.cancel();
+    for(shared_ptr<Job>& job : active)
+      if(job) job->token.cancel();
+  }
+
+  // drains the queue before stopping, so no future is left without a value
+  void JobQueue::work(size_t slot){
+    while(true){
+      shared_ptr<Job> job;
+      {
+        unique_lock<mutex> lock(queue_mutex);
+        work_cv.wait(lock, [this]{ return !queue.empty() || stopping; });
+        if(queue.empty()) return;
+        job = queue.front();
+        queue.pop_front();
+        job->deadline = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(job->timeout));
+        active[slot] = job;
+      }
+      watchdog_cv.notify_one();
+
+      job->fn(job->token);
+
+      lock_guard<mutex> lock(queue_mutex);
+      active[slot] = nullptr;
+    }
+  }
+
+  void JobQueue::watch(){
+    unique_lock<mutex> lock(queue_mutex);
+    while(!stopping){
+      chrono::steady_clock::time_point now = chrono::steady_clock::now();
+      chrono::steady_clock::time_point next = chrono::steady_clock::time_point::max();
+      for(shared_ptr<Job>& job : active){
+        if(!job || job->timeout <= 0) continue;
+        if(job->deadline <= now) job->token.cancel();
+        else next = min(next, job->deadline);
+      }
+      if(next == chrono::steady_clock::time_point::max()) watchdog_cv.wait(lock);
+      else watchdog_cv.wait_until(lock, next);
+    }
+  }
+
+  // Fills the array without tracing, so the run measures the algorithm and
+  // nothing else
+  template <typename Target> static void seed(Target& target, const SortJob& job, unsigned seed){
+    vector<int> values;
+    generate(job.distribution, job.size, job.k, seed, values);
+    vector<typename Target::value_type> elements;
+    make_elements(values, elements);
+    target.assign(elements);
+  }
+
+  // Order-independent hash of the elements, a sum of mixed (splitmix64)
+  // element hashes
+  template <typename Target> static uint64_t fingerprint(const Target& target){
+    uint64_t sum = 0;
+    for(size_t i = 0; i < target.size(); i++){
+      uint64_t x = ElementTraits<typename Target::value_type>::hash(target.peek(i));
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+      sum += x ^ (x >> 31);
+    }
+    return sum;
+  }
+
+  // Linear checks without tracing: ascending in the comparator's order, the
+  // same elements as before and, where the algorithm promises stability and
+  // the type remembers input positions, equal elements in input order
+  template <typename Target> static Verdict verify(Target& target, uint64_t input, bool stable){
+    using T = typename Target::value_type;
+    for(size_t i = 1; i < target.size(); i++){
+      T previous = target.peek(i-1);
+      T current = target.peek(i);
+      if(target.comparator(current, previous)) return Verdict::Unsorted;
+      if constexpr(HasTag<T>::value){
+        if(stable && !target.comparator(previous, current) && ElementTraits<T>::tag(previous) > ElementTraits<T>::tag(current))
+          return Verdict::Unstable;
+      }
+    }
+    return fingerprint(target) == input ? Verdict::Sorted : Verdict::Changed;
+  }
+
+  // Threads kept for all runs of a job, one per array. ready() returns once
+  // every thread is parked waiting for the next run, so a timed run pays
+  // for the wakeup but not for creating threads.
+  class Gang {
+    vector<thread> threads;
+    mutex gang_mutex;
+    condition_variable gang_cv;
+    size_t generation = 0;
+    size_t parked = 0;
+    size_t finished = 0;
+    bool quit = false;
+
+    void work(size_t index, const function<void(size_t)>& fn){
+      size_t seen = 0;
+      unique_lock<mutex> lock(gang_mutex);
+      while(true){
+        parked++;
+        gang_cv.notify_all();
+        gang_cv.wait(lock, [&]{ return quit || generation != seen; });
+        if(quit) return;
+        seen = generation;
+        lock.unlock();
+        fn(index);
+        lock.lock();
+        finished++;
+        gang_cv.notify_all();
+      }
+    }
+
+  public:
+    Gang(size_t count, function<void(size_t)> fn){
+      for(size_t i = 0; i < count; i++)
+        threads.emplace_back([this, i, fn]{ work(i, fn); });
+    }
+
+    ~Gang(){
+      {
+        lock_guard<mutex> lock(gang_mutex);
+        quit = true;
+      }
+      gang_cv.notify_all();
+      for(thread& t : threads) t.join();
+    }
+
+    void ready(){
+      unique_lock<mutex> lock(gang_mutex);
+      gang_cv.wait(lock, [&]{ return parked == threads.size(); });
+    }
+
+    // one call of fn per thread, returns when all are done
+    void run(){
+      unique_lock<mutex> lock(gang_mutex);
+      parked = finished = 0;
+      generation++;
+      gang_cv.notify_all();
+      gang_cv.wait(lock, [&]{ return finished == threads.size(); });
+    }
+  };
+
+  // A single array is sorted on this thread. Several are seeded one after
+  // another (seed, seed+1, ...) and sorted at once by the same algorithm
+  // instance, one thread each, timed from a common start until the last
+  // one is done. The threads are created once and parked before the clock
+  // starts. Every run starts from freshly seeded arrays; only the
+  // last one is verified.
+  template <typename Target> static void measure(vector<Target>& targets, const SortJob& job, const CancellationToken& token, SortResult& result, PerfCounters* perf = nullptr){
+    using Trace = typename Target::trace_type;
+    using T = typename Target::value_type;
+    typename map<string, IAlgo<Target>*>::iterator algorithm = algos<Trace, T>.find(job.algorithm);
+    if(algorithm == algos<Trace, T>.end()) return;
+    vector<uint64_t> inputs;
+    unique_ptr<Gang> gang;
+    if(targets.size() > 1)
+      gang.reset(new Gang(targets.size(), [&](size_t i){ algorithm->second->run(targets[i], token); }));
+    int runs = max(0, job.warmup) + max(1, job.reps);
+    for(int run = 0; run < runs && !token.cancelled(); run++){
+      bool timed = run >= job.warmup;
+      inputs.clear();
+      for(size_t i = 0; i < targets.size(); i++){
+        seed(targets[i], job, job.seed + i);
+        if(job.verify) inputs.push_back(fingerprint(targets[i]));
+      }
+
+      if(gang) gang->ready();
+      if(perf && timed) perf->start();
+      chrono::high_resolution_clock::time_point time_start = chrono::high_resolution_clock::now();
+      if(gang) gang->run();
+      else algorithm->second->run(targets[0], token);
+      chrono::high_resolution_clock::time_point time_end = chrono::high_resolution_clock::now();
+      if(perf && timed) perf->stop();
+      if(timed && !token.cancelled())
+        result.times.push_back(chrono::duration_cast<chrono::microseconds>(time_end - time_start).count());
+    }
+    result.interrupted = token.cancelled();
+
+    if(!job.verify || result.interrupted) return;
+    map<string, Capabilities>::const_iterator promises = capabilities.find(job.algorithm);
+    bool stable = promises != capabilities.end() && promises->second.has(Stable);
+    result.verdict = Verdict::Sorted;
+    for(size_t i = 0; i < targets.size() && result.verdict == Verdict::Sorted; i++)
+      result.verdict = verify(targets[i], inputs[i], stable);
+  }
+
+  template <typename T> static void run_typed(const SortJob& job, const CancellationToken& token, SortResult& result, PerfCounters* perf){
+    // only timed runs sort several arrays, counts are per array anyway
+    switch(job.tracing){
+      case Tracing::None: {
+        vector<Array<NoTrace, T>> targets(max<size_t>(1, job.arrays));
+        measure(targets, job, token, result, perf);
+        break;
+      }
+      case Tracing::Counting: {
+        vector<Array<CountingTrace, T>> targets(1);
+        measure(targets, job, token, result);
+        result.counters = targets[0].counters();
+        break;
+      }
+      case Tracing::Cache: {
+        CacheSim sim;
+        sim.configure(job.cache, job.line);
+        vector<Array<CacheTrace<T>, T>> targets(1);
+        targets[0].sim = &sim;
+        measure(targets, job, token, result);
+        result.levels = sim.levels;
+        break;
+      }
+    }
+  }
+
+  const char* verdict_name(Verdict verdict){
+    switch(verdict){
+      case Verdict::Sorted: return "ok";
+      case Verdict::Unsorted: return "unsorted";
+      case Verdict::Changed: return "changed";
+      case Verdict::Unstable: return "unstable";
+      default: return "-";
+    }
+  }
+
+  bool supports(const string& algorithm, const string& type){
+    bool found = false;
+    ElementTypes::visit(type, [&](auto tag){
+      found = algos<NoTrace, typename decltype(tag)::type>.count(algorithm);
+    });
+    return found;
+  }
+
+  SortResult run_job(const SortJob& job, const CancellationToken& token){
+    // the scheduler is shared by the whole process, a job resizing it (or
+    // restarting it under its counters) must not overlap another one
+    static mutex owner;
+    lock_guard<mutex> lock(owner);
+    SortResult result;
+
+    // counters have to be open before the workers start and are only
+    // complete once they have exited again, so a counted job restarts the
+    // workers once around all of its runs
+    PerfCounters perf;
+    bool counted = job.perf && job.tracing == Tracing::None;
+    if(counted){
+      scheduler().stop();
+      counted = perf.open();
+    }
+
+    scheduler().start(job.threads);
+    ElementTypes::visit(job.type, [&](auto tag){
+      run_typed<typename decltype(tag)::type>(job, token, result, counted ? &perf : nullptr);
+    });
+
+    if(counted){
+      scheduler().stop();
+      result.perf = perf.read();
+    }
+    return result;
+  }
+}
@@ -0,0 +1,115 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <cstddef>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "algo.h"
+#include "cachesim.h"
+#include "perf.h"
+
+namespace algo {
+  // Fixed pool of threads running queued jobs in submission order. Every job
+  // gets its own cancellation token, cancelled by cancel() or by the
+  // watchdog once the job has run for longer than its timeout.
+  class JobQueue {
+  public:
+    JobQueue(unsigned workers = 1);
+    ~JobQueue();
+
+    template <typename F> auto submit(F fn, double timeout = 0) -> std::future<decltype(fn(std::declval<const CancellationToken&>()))> {
+      using R = decltype(fn(std::declval<const CancellationToken&>()));
+      std::shared_ptr<std::packaged_task<R(const CancellationToken&)>> task(new std::packaged_task<R(const CancellationToken&)>(std::move(fn)));
+      std::future<R> result = task->get_future();
+      enqueue([task](const CancellationToken& token){ (*task)(token); }, timeout);
+      return result;
+    }
+
+    // cancels everything queued or running, queued jobs still run but see
+    // their token cancelled from the start
+    void cancel();
+
+  private:
+    struct Job {
+      std::function<void(const CancellationToken&)> fn;
+      double timeout;
+      CancellationToken token;
+      std::chrono::steady_clock::time_point deadline;
+    };
+
+    std::mutex queue_mutex;
+    std::condition_variable work_cv;
+    std::condition_variable watchdog_cv;
+    std::deque<std::shared_ptr<Job>> queue;
+    std::vector<std::shared_ptr<Job>> active;
+    std::vector<std::thread> workers;
+    std::thread watchdog;
+    bool stopping = false;
+
+    void enqueue(std::function<void(const CancellationToken&)> fn, double timeout);
+    void work(size_t slot);
+    void watch();
+  };
+
+  enum class Tracing { None, Counting, Cache };
+
+  // Outcome of checking a finished sort, Unchecked when it wasn't asked for
+  // or the run was interrupted
+  enum class Verdict { Unchecked, Sorted, Unsorted, Changed, Unstable };
+  const char* verdict_name(Verdict verdict);
+
+  // One cell's sort runs: a seeded input from one of the generators,
+  // converted to the named element type and sorted by algorithm on the
+  // given number of scheduler workers, traced as asked for; warmup untimed
+  // runs first, then reps timed ones, re-seeded every time. Untraced runs
+  // can also read hardware counters, and sort several arrays concurrently.
+  // Verified runs check every array afterwards, outside the timed part.
+  struct SortJob {
+    std::string algorithm;
+    std::string type = "int";
+    std::string distribution = "Uniform random";
+    size_t size = 0;
+    size_t k = 0;
+    unsigned seed = 1;
+    unsigned threads = 1;
+    size_t arrays = 1;
+    int warmup = 0;
+    int reps = 1;
+    Tracing tracing = Tracing::None;
+    std::vector<CacheConfig> cache;
+    size_t line = 64;
+    bool perf = false;
+    bool verify = false;
+  };
+
+  struct SortResult {
+    bool interrupted = false;
+    Verdict verdict = Verdict::Unchecked;
+    // µs per timed run, fewer than reps if interrupted
+    std::vector<size_t> times;
+    Counters counters;
+    std::vector<CacheLevel> levels;
+    PerfSample perf;
+  };
+
+  // whether algorithm is built for the named element type (radix sorts
+  // need an integer-like key)
+  bool supports(const std::string& algorithm, const std::string& type);
+
+  // Sizes the process-wide scheduler for the job, restarting it if needed,
+  // so jobs never overlap: a second one waits for the first to finish.
+  // Hardware counters (summed over all timed runs) are opened once per job
+  // with the workers started after them.
+  SortResult run_job(const SortJob& job, const CancellationToken& token);
+}
+
+#endif
@@ -6,8 +6,11 @@
 #include <thread>
 #include <random>
 #include <mutex>
+#include <atomic>
+#include <future>
 #include <chrono>
 #include <sstream>
+#include <algorithm>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -30,7 +33,21 @@
 #define MAX_VERTEX_BUFFER 512 * 1024
 #define MAX_ELEMENT_BUFFER 128 * 1024
 
+#define MAX_LANES 8
+
 #include "algo.h"
+#include "ring.h"
+#include "snapshot.h"
+#include "recording.h"
+#include "clock.h"
+#include "cachesim.h"
+#include "scheduler.h"
+#include "jobs.h"
+#include "generators.h"
+#include "gui/bars.h"
+#include "gui/decimate.h"
+#include "bench.h"
+#include "video.h"
 
 #if defined(__APPLE__)
   #include <objc/message.h>       // Required for: objc_msgsend(), sel_registerName()
@@ -45,80 +62,471 @@ int width = 0, height = 0;
 struct nk_context *ctx;
 
 auto rng = default_random_engine {};
-vector<thread*> threads;
 char* windowname;
 int elements = 200;
-int read_delay = 100;
-int write_delay = 500;
+float read_cost = 100;
+float write_cost = 500;
+float compare_cost = 0;
+float time_scale = 1;
 string last_action = "nothing";
 string last_time = "0";
-atomic<size_t> read_count = 0;
-atomic<size_t> write_count = 0;
-vector<algo::TraceableAtom<int>> target;
-bool running = false;
 vector<const char*> algo_vec;
-int algo_current = 0;
-mutex vector_busy_mutex;
+vector<const char*> distribution_vec;
+int distribution_current = 0;
+int inversions = 0;
+int show_every_access = 0;
+bool lossless = false;
+
+// writes are marked TOUCHED_WRITE + the worker that made them
+enum : uint8_t { UNTOUCHED, TOUCHED_READ, TOUCHED_WRITE, COLUMN_RANGE = 255 };
+
+// When a lane's ring is full its run doesn't wait for the renderer: it
+// drops deltas until there is room again, then hands over a whole copy of
+// its mirror of the array followed by a Snapshot marker. The renderer
+// installs the newest snapshot and skips whatever was queued before its
+// marker.
+struct Snapshot {
+  uint32_t version = 0;
+  vector<int> values;
+};
+
+// One chart and the run behind it. A normal run only uses the first lane,
+// a race sorts the same input in every lane at once, each with its own
+// algorithm, counters and modelled clock.
+struct Lane {
+  int algorithm = 0;
+  // what the lane is running, fixed when the run is started
+  const char* name = "";
+
+  // only the lane's sort thread touches target; it publishes every access
+  // here and the renderer applies them to its own copy, shown
+  algo::Array<algo::CallbackTrace<int>> target;
+  algo::Ring<algo::Access<int>> events{1 << 16};
+  algo::TripleBuffer<Snapshot> snapshots;
+  vector<int> mirror;
+  uint32_t snapshot_version = 0;
+  bool overflowed = false;
+
+  // parallel algorithms trace from several scheduler workers at once
+  mutex trace_mutex;
+  atomic<size_t> read_count = 0;
+  atomic<size_t> write_count = 0;
+  // accesses advance a virtual clock instead of sleeping; the renderer
+  // paces what it shows off the same cost model, every lane with the same
+  // budget per frame
+  algo::VirtualClock vclock;
+  algo::CacheSim cache;
+  chrono::high_resolution_clock::duration blocked_time;
+
+  // finish is the modelled time it took, valid once finished is set
+  atomic<bool> running = false;
+  atomic<bool> finished = false;
+  double finish = 0;
+
+  vector<int> shown;
+  vector<uint8_t> touched;
+  uint32_t snapshot_skipping = 0;
+  algo::Pacer pacer;
+
+  // Arrays wider than the chart are drawn as one min/max/mean per pixel
+  // column, kept up to date from the same writes as shown
+  gui::ColumnDecimator decimator;
+  bool decimator_stale = true;
+  int decimator_width = 0;
+  vector<uint8_t> range_colors;
+};
+
+Lane lanes[MAX_LANES];
+int lane_count = 1;
+// lanes of the current or last run, the only ones shown
+int active_lanes = 1;
+
+// Recorded runs play back into the first lane's shown/touched copy
+algo::Recording recording;
+algo::Player player(recording);
+bool replaying = false;
+atomic<bool> replay_pending = false;
+bool playing = false;
+char trace_path[256] = "sort.trace";
 
 nk_color color_red = nk_rgba(255, 0, 0, 128);
 nk_color color_green = nk_rgba(0, 255, 0, 128);
 nk_color color_blue = nk_rgba(0, 0, 255, 128);
+nk_color color_workers[] = {
+  color_red,
+  nk_rgba(255, 160, 0, 128),
+  nk_rgba(255, 0, 255, 128),
+  nk_rgba(0, 255, 255, 128),
+  nk_rgba(255, 255, 0, 128),
+  nk_rgba(160, 0, 255, 128),
+  nk_rgba(255, 255, 255, 128),
+  nk_rgba(0, 160, 255, 128),
+};
 nk_color color_default = color_green;
+nk_color color_range = nk_rgba(255, 255, 255, 64);
+nk_color color_winner = nk_rgb(160, 120, 0);
+
+// Bars are drawn straight with GL after the UI, Nuklear only does the settings
+gui::BarRenderer bars;
+
+void bar_palette(){
+  uint8_t rgba[256][4];
+  for(size_t i = 0; i < 256; i++){
+    nk_color color = i == COLUMN_RANGE ? color_range : i >= TOUCHED_WRITE ? color_workers[(i - TOUCHED_WRITE) % 8] : i == TOUCHED_READ ? color_blue : color_default;
+    rgba[i][0] = color.r;
+    rgba[i][1] = color.g;
+    rgba[i][2] = color.b;
+    rgba[i][3] = color.a;
+  }
+  bars.palette(rgba);
+}
 
-void fill_targets(){
-  try{
-    // clear
-    printf("Clearing vector\n");
-    target.clear();
-
-    // fill
-    printf("Seeding next run\n");
-    for(int i = 1; i <= elements; i++){
-      lock_guard<mutex> lock(vector_busy_mutex);
-
-      target.push_back(i);
-      target.back().cb_write.push_back([](algo::TraceableAtom<int>& atom){
-        last_action = "write";
-        write_count++;
-        this_thread::sleep_for(chrono::microseconds(write_delay));
-        if(!running) throw algo::InterruptedException();
-      });
-      target.back().cb_read.push_back([](algo::TraceableAtom<int>& atom){
-        last_action = "read";
-        read_count++;
-        this_thread::sleep_for(chrono::microseconds(read_delay));
-        if(!running) throw algo::InterruptedException();
+// Every access of a live run also goes through its lane's cache simulator
+int cache_kib[3] = {32, 1024, 8192};
+int cache_ways[3] = {8, 16, 16};
+int cache_line = 64;
+
+int worker_threads = max(1u, thread::hardware_concurrency());
+
+// Runs and recordings go through a single job thread, the future tells
+// whether one is still going
+algo::JobQueue jobs;
+future<void> current_run;
+
+bool running(){
+  return current_run.valid() && current_run.wait_for(chrono::seconds(0)) != future_status::ready;
+}
+
+algo::CostModel costs(){
+  return {read_cost, write_cost, compare_cost};
+}
+
+// Called with the lane's trace_mutex held, or before its run has started
+void publish_snapshot(Lane& lane){
+  Snapshot& snapshot = lane.snapshots.write_buffer();
+  snapshot.version = ++lane.snapshot_version;
+  snapshot.values = lane.mirror;
+  lane.snapshots.publish();
+  lane.events.push({algo::Access<int>::Snapshot, 0, snapshot.version, 0, 0});
+  lane.overflowed = false;
+}
+
+void publish(Lane& lane, const algo::Access<int>& access, const algo::CancellationToken& token){
+  // the snapshot already includes this access, mirror is updated first
+  if(lane.overflowed){
+    if(!lane.events.full()) publish_snapshot(lane);
+    return;
+  }
+  if(lane.events.push(access)) return;
+  if(!lossless){
+    lane.overflowed = true;
+    return;
+  }
+
+  // block rather than drop, the renderer's copy must see every delta; time
+  // spent here is the renderer pacing us and not part of the run
+  chrono::high_resolution_clock::time_point wait_start = chrono::high_resolution_clock::now();
+  while(!lane.events.push(access)){
+    // a cancelled run doesn't need to be shown anymore
+    if(token.cancelled()) break;
+    this_thread::yield();
+  }
+  lane.blocked_time += chrono::high_resolution_clock::now() - wait_start;
+}
+
+void traced(Lane& lane, const algo::Access<int>& access, const algo::CancellationToken& token){
+  lock_guard<mutex> lock(lane.trace_mutex);
+  if(access.kind == algo::Access<int>::Write) lane.mirror[access.index] = access.value;
+  publish(lane, access, token);
+  switch(access.kind){
+    case algo::Access<int>::Read:
+      lane.read_count++;
+      lane.vclock.read();
+      lane.cache.access(access.index * sizeof(int));
+      break;
+    case algo::Access<int>::Write:
+      lane.write_count++;
+      lane.vclock.write();
+      lane.cache.access(access.index * sizeof(int));
+      break;
+    case algo::Access<int>::Compare:
+      lane.vclock.compare();
+      break;
+    case algo::Access<int>::Snapshot:
+      break;
+  }
+}
+
+// Untraced input from the selected generator
+vector<int> next_input(){
+  vector<int> values;
+  algo::generate(distribution_vec[distribution_current], elements, inversions, rng(), values);
+  return values;
+}
+
+// Hooks the lane's array up to its ring and fills it straight into storage,
+// the renderer gets the values as one snapshot once there is room for its
+// marker
+void seed_lane(Lane& lane, const vector<int>& values, const algo::CancellationToken& token){
+  lane.vclock.model = costs();
+  lane.cache.configure({
+    {"L1", (size_t)cache_kib[0] << 10, (size_t)cache_ways[0]},
+    {"L2", (size_t)cache_kib[1] << 10, (size_t)cache_ways[1]},
+    {"LLC", (size_t)cache_kib[2] << 10, (size_t)cache_ways[2]},
+  }, cache_line);
+  lane.target.cb_write = [&lane, &token](size_t index, const int& old_value, const int& value){
+    traced(lane, {algo::Access<int>::Write, (uint8_t)algo::worker, (uint32_t)index, old_value, value}, token);
+  };
+  lane.target.cb_read = [&lane, &token](size_t index){
+    traced(lane, {algo::Access<int>::Read, (uint8_t)algo::worker, (uint32_t)index, 0, 0}, token);
+  };
+  lane.target.cb_compare = [&lane, &token](){
+    traced(lane, {algo::Access<int>::Compare, (uint8_t)algo::worker, 0, 0, 0}, token);
+  };
+
+  lane.target.assign(values);
+  lane.mirror = values;
+  while(lane.events.full() && !token.cancelled()) this_thread::yield();
+  publish_snapshot(lane);
+
+  lane.write_count = 0;
+  lane.read_count = 0;
+  lane.vclock.reset();
+  lane.cache.reset_stats();
+  lane.blocked_time = lane.blocked_time.zero();
+}
+
+void run_lane(Lane& lane, algo::IAlgo<algo::Array<algo::CallbackTrace<int>>>* algorithm, const algo::CancellationToken& token){
+  chrono::high_resolution_clock::time_point time_start = chrono::high_resolution_clock::now();
+  algorithm->run(lane.target, token);
+  chrono::high_resolution_clock::time_point time_end = chrono::high_resolution_clock::now();
+  size_t time_duration = chrono::duration_cast<chrono::microseconds>(time_end - time_start - lane.blocked_time).count();
+  if(token.cancelled()){
+    printf("%s interrupted\n", lane.name);
+  }else{
+    printf("%s took %ldµs, modelled %.0fµs\n", lane.name, time_duration, lane.vclock.now());
+    lane.finish = lane.vclock.now();
+    lane.finished = true;
+  }
+  lane.running = false;
+}
+
+// Sorts the same input in every active lane. A single lane runs on the job
+// thread, a race starts one thread per lane at once.
+void fill_targets(const algo::CancellationToken& token){
+  algo::scheduler().start(worker_threads);
+
+  for(int i = 0; i < active_lanes; i++){
+    lanes[i].finished = false;
+    lanes[i].running = true;
+  }
+
+  printf("Seeding next run\n");
+  vector<int> values = next_input();
+  lossless = show_every_access;
+  for(int i = 0; i < active_lanes; i++)
+    seed_lane(lanes[i], values, token);
+
+  if(token.cancelled()){
+    printf("Interrupted\n");
+    for(int i = 0; i < active_lanes; i++) lanes[i].running = false;
+    return;
+  }
+
+  printf("Running\n");
+  chrono::high_resolution_clock::time_point time_start = chrono::high_resolution_clock::now();
+  if(active_lanes == 1){
+    run_lane(lanes[0], algo::algos<algo::CallbackTrace<int>>[lanes[0].name], token);
+  }else{
+    promise<void> start;
+    shared_future<void> started = start.get_future().share();
+    vector<thread> threads;
+    for(int i = 0; i < active_lanes; i++){
+      algo::IAlgo<algo::Array<algo::CallbackTrace<int>>>* algorithm = algo::algos<algo::CallbackTrace<int>>[lanes[i].name];
+      threads.emplace_back([i, algorithm, started, &token]{
+        started.wait();
+        run_lane(lanes[i], algorithm, token);
       });
+    }
+    start.set_value();
+    for(thread& t : threads) t.join();
+  }
+  chrono::high_resolution_clock::time_point time_end = chrono::high_resolution_clock::now();
+  last_time = to_string(chrono::duration_cast<chrono::microseconds>(time_end - time_start).count());
+}
+
+// Captures a full run at full speed without any delays, for playback
+void record_run(const algo::CancellationToken& token){
+  vector<int> values = next_input();
+
+  algo::Array<algo::RecordingTrace> array;
+  array.assign(values);
+  array.recording = &recording;
+  recording.begin(values);
+  algo::scheduler().start(worker_threads);
+
+  printf("Recording\n");
+  chrono::high_resolution_clock::time_point time_start = chrono::high_resolution_clock::now();
+  algo::algos<algo::RecordingTrace>[lanes[0].name]->run(array, token);
+  chrono::high_resolution_clock::time_point time_end = chrono::high_resolution_clock::now();
+  if(token.cancelled()) printf("Interrupted\n");
+  size_t time_duration = chrono::duration_cast<chrono::microseconds>(time_end - time_start).count();
+  recording.finish();
+  printf("Recorded %zu events (%zu bytes) in %ldµs\n", recording.events, recording.bytes.size(), time_duration);
+  last_time = to_string(time_duration);
+
+  replay_pending = true;
+}
+
+void apply_access(Lane& lane, const algo::Access<int>& access){
+  switch(access.kind){
+    case algo::Access<int>::Write:
+      if(lane.decimator.active() && !lane.decimator_stale){
+        lane.decimator.write(access.index, lane.shown[access.index], access.value);
+        lane.decimator.touch(access.index, TOUCHED_WRITE + access.worker);
+      }
+      lane.shown[access.index] = access.value;
+      lane.touched[access.index] = TOUCHED_WRITE + access.worker;
+      last_action = "write";
+      break;
+    case algo::Access<int>::Read:
+      if(lane.touched[access.index] == UNTOUCHED) lane.touched[access.index] = TOUCHED_READ;
+      if(lane.decimator.active() && !lane.decimator_stale) lane.decimator.touch(access.index, TOUCHED_READ);
+      last_action = "read";
+      break;
+    case algo::Access<int>::Compare:
+      last_action = "compare";
+      break;
+    case algo::Access<int>::Snapshot:
+      break;
+  }
+}
 
-      if(!running) return;
+void start_replay(){
+  Lane& lane = lanes[0];
+  active_lanes = 1;
+  player.reset();
+  lane.shown = player.state();
+  lane.touched.assign(lane.shown.size(), UNTOUCHED);
+  lane.decimator_stale = true;
+  replaying = true;
+  playing = false;
+}
+
+void seek_replay(size_t event){
+  Lane& lane = lanes[0];
+  player.seek(event);
+  lane.shown = player.state();
+  lane.touched.assign(lane.shown.size(), UNTOUCHED);
+  lane.decimator_stale = true;
+}
+
+// Installs the newest snapshot if there is one, everything queued before its
+// marker is then skipped
+void take_snapshot(Lane& lane){
+  if(!lane.snapshots.take()) return;
+  const Snapshot& snapshot = lane.snapshots.read_buffer();
+  lane.shown = snapshot.values;
+  lane.touched.assign(lane.shown.size(), UNTOUCHED);
+  lane.decimator_stale = true;
+  lane.snapshot_skipping = snapshot.version;
+}
+
+// Applies what the lane's sort thread published, as far as the modelled
+// time budget for this frame reaches
+void drain_events(Lane& lane){
+  fill(lane.touched.begin(), lane.touched.end(), UNTOUCHED);
+  lane.decimator.clear_touched();
+  take_snapshot(lane);
+
+  algo::CostModel model = costs();
+  algo::Access<int> access;
+  for(size_t n = 0; n < (1 << 16) && lane.events.peek(access); n++){
+    bool marker = access.kind == algo::Access<int>::Snapshot;
+    if(lane.snapshot_skipping){
+      lane.events.pop(access);
+      if(marker && access.index == lane.snapshot_skipping) lane.snapshot_skipping = 0;
+      continue;
+    }
+    // published after this frame's take, but already in the queue
+    if(marker){
+      lane.events.pop(access);
+      take_snapshot(lane);
+      if(lane.snapshot_skipping == access.index) lane.snapshot_skipping = 0;
+      continue;
     }
+    if(!lane.pacer.spend(model.cost(access))) return;
+    lane.events.pop(access);
+    apply_access(lane, access);
+  }
+  if(!replaying || !playing) lane.pacer.idle();
+}
+
+void advance_replay(){
+  if(!replaying || !playing) return;
+
+  Lane& lane = lanes[0];
+  algo::CostModel model = costs();
+  algo::Access<int> access;
+  while(player.peek(access)){
+    if(!lane.pacer.spend(model.cost(access))) return;
+    player.step(access);
+    apply_access(lane, access);
+  }
+  playing = false;
+  lane.pacer.idle();
+}
+
+// Fixes which algorithms the next run shows, on the UI thread
+void arm_lanes(int count){
+  active_lanes = count;
+  for(int i = 0; i < count; i++)
+    lanes[i].name = algo_vec[lanes[i].algorithm];
+}
 
-    // shuffle
-    printf("Shuffling\n");
-    srand(time(nullptr));
-    for(int i = elements-1; i > 0; i--){
-      int irand = rng() % (i+1);
-      algo::swap(target[irand], target[i]);
-      if(!running) return;
+// 1 for the fastest lane in modelled time, once its place can't change
+// anymore: shown all the way through, and every lane still running has
+// already spent more. 0 while that isn't known, or if it was interrupted.
+int finishing_place(int i){
+  const Lane& lane = lanes[i];
+  if(!lane.finished || !lane.events.empty()) return 0;
+  int place = 1;
+  for(int j = 0; j < active_lanes; j++){
+    const Lane& other = lanes[j];
+    if(j == i) continue;
+    if(other.finished){
+      if(other.finish < lane.finish || (other.finish == lane.finish && j < i)) place++;
+    }else if(other.running && other.vclock.now() < lane.finish){
+      return 0;
     }
+  }
+  return place;
+}
 
-    printf("Resetting results\n");
-    write_count = 0;
-    read_count = 0;
-
-    // sort
-    printf("Running\n");
-    chrono::high_resolution_clock::time_point time_start = chrono::high_resolution_clock::now();
-    algo::run(std::string(algo_vec[algo_current]));
-    chrono::high_resolution_clock::time_point time_end = chrono::high_resolution_clock::now();
-    size_t time_duration = chrono::duration_cast<chrono::microseconds>(time_end - time_start).count();
-    printf("Took %ldµs\n", time_duration);
-    last_time = to_string(time_duration);
-  }catch(algo::InterruptedException& e) {
-    printf("Interrupted\n");
+string lane_stats(const Lane& lane){
+  if(replaying){
+    const algo::Counters& counters = recording.counters;
+    return to_string(counters.reads) + " reads, " + to_string(counters.writes) + " writes, " + to_string((size_t)costs().time(counters)) + "µs modelled";
   }
+  return to_string(lane.read_count) + " reads, " + to_string(lane.write_count) + " writes, " + to_string((size_t)lane.vclock.now()) + "µs modelled";
+}
 
-  running = false;
+// colored by what touched each bar since the last frame
+void draw_lane(Lane& lane, int chart_x, int chart_y, int chart_w, int chart_h){
+  if(lane.decimator_stale || chart_w != lane.decimator_width){
+    lane.decimator.rebuild(lane.shown, max(chart_w, 1));
+    lane.range_colors.assign(lane.decimator.size(), COLUMN_RANGE);
+    lane.decimator_width = chart_w;
+    lane.decimator_stale = false;
+  }
+  if(lane.decimator.active()){
+    // means as the bars, with each column's min..max range over them
+    lane.decimator.flush(lane.shown);
+    bars.draw(lane.decimator.means, lane.decimator.touched, lane.shown.size(), chart_x, chart_y, chart_w, chart_h);
+    bars.draw(lane.decimator.maxs, lane.range_colors, lane.shown.size(), chart_x, chart_y, chart_w, chart_h, &lane.decimator.mins);
+  }else{
+    bars.draw(lane.shown, lane.touched, lane.shown.size(), chart_x, chart_y, chart_w, chart_h);
+  }
 }
 
 void render(){
@@ -146,6 +554,12 @@ void render(){
     exit(1);
   }
 
+  if(!bars.init()){
+    fprintf(stderr, "Failed to setup the bar renderer\n");
+    exit(1);
+  }
+  bar_palette();
+
   ctx = nk_glfw3_init(win, NK_GLFW3_INSTALL_CALLBACKS);
   {
     struct nk_font_atlas *atlas;
@@ -159,8 +573,12 @@ void render(){
     objc_msgSend(glfwGetNSGLContext(win), sel_registerName("update"));
   #endif
 
+  double frame_time = glfwGetTime();
   while(!glfwWindowShouldClose(win)){
     glfwPollEvents();
+    double now = glfwGetTime();
+    double dt = now - frame_time;
+    frame_time = now;
     nk_glfw3_new_frame();
 
     int width_border = 1;
@@ -169,59 +587,193 @@ void render(){
 
     if(nk_begin(ctx, "Settings", nk_rect(0, 0, width_settings, height), NK_WINDOW_TITLE|NK_WINDOW_BORDER)){
       nk_layout_row_dynamic(ctx, 25, 1);
-      if(nk_button_label(ctx, running ? "Cancel" : "Start")){
-        running = !running;
-        if(running)
-          threads.push_back(new thread(fill_targets));
+      if(nk_button_label(ctx, running() ? "Cancel" : "Start")){
+        if(running()){
+          jobs.cancel();
+        }else{
+          replaying = false;
+          arm_lanes(lane_count);
+          current_run = jobs.submit(fill_targets);
+        }
       }
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      algo_current = nk_combo(ctx, &algo_vec[0], algo_vec.size(), algo_current, 25, nk_vec2(200, 200));
+      if(!running() && nk_button_label(ctx, "Record")){
+        replaying = false;
+        arm_lanes(1);
+        current_run = jobs.submit(record_run);
+      }
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_property_int(ctx, "Elements:", 0, &elements, 4096, 100, 2);
+      lanes[0].algorithm = nk_combo(ctx, &algo_vec[0], algo_vec.size(), lanes[0].algorithm, 25, nk_vec2(200, 200));
 
+      // more than one lane races the algorithms below against the first
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_property_int(ctx, "Write Delay (µs):", 0, &write_delay, 1000, 100, 1);
+      nk_property_int(ctx, "Race lanes:", 1, &lane_count, MAX_LANES, 1, 1);
+      for(int i = 1; i < lane_count; i++){
+        nk_layout_row_dynamic(ctx, 25, 1);
+        lanes[i].algorithm = nk_combo(ctx, &algo_vec[0], algo_vec.size(), lanes[i].algorithm, 25, nk_vec2(200, 200));
+      }
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_property_int(ctx, "Read Delay (µs):", 0, &read_delay, 1000, 100, 1);
+      nk_property_int(ctx, "Elements:", 0, &elements, 1 << 20, 100, 2);
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_label(ctx, (string("Last action: ") + last_action).c_str(), NK_TEXT_LEFT);
+      distribution_current = nk_combo(ctx, &distribution_vec[0], distribution_vec.size(), distribution_current, 25, nk_vec2(200, 200));
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_label(ctx, (string("Last time: ") + last_time + "µs").c_str(), NK_TEXT_LEFT);
+      nk_property_int(ctx, "Inversions (0 = auto):", 0, &inversions, 1 << 20, 1, 1);
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_label(ctx, (string("Total writes: ") + to_string(write_count)).c_str(), NK_TEXT_LEFT);
+      nk_property_int(ctx, "Threads:", 1, &worker_threads, algo::max_workers - 1, 1, 1);
 
       nk_layout_row_dynamic(ctx, 25, 1);
-      nk_label(ctx, (string("Total reads: ") + to_string(read_count)).c_str(), NK_TEXT_LEFT);
-    }
-    nk_end(ctx);
+      nk_property_float(ctx, "Write cost (µs):", 0, &write_cost, 10000, 10, 1);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_property_float(ctx, "Read cost (µs):", 0, &read_cost, 10000, 10, 1);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_property_float(ctx, "Compare cost (µs):", 0, &compare_cost, 10000, 10, 1);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_property_float(ctx, "Speed (x):", 0.001f, &time_scale, 1000000, 1, 0.1f);
 
-    if(nk_begin(ctx, "Chart", nk_rect(width_settings+width_border*2, 0, width_chart, height), NK_WINDOW_TITLE|NK_WINDOW_BORDER|NK_WINDOW_ROM)){
-      nk_layout_row_static(ctx, height-55, width_chart-30, 1);
-      nk_chart_begin_colored(ctx, NK_CHART_COLUMN, color_green, color_red, target.size(), 0, target.size());
-      {
-        lock_guard<mutex> lock(vector_busy_mutex);
-        for(size_t i = 0; i < target.size(); i++){
-          nk_chart_push(ctx, target[i].without_cb());
+      // otherwise the view skips ahead whenever the run outpaces it
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_checkbox_label(ctx, "Show every access", &show_every_access);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_label(ctx, (string("Last action: ") + last_action).c_str(), NK_TEXT_LEFT);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_label(ctx, (string("Wall time: ") + last_time + "µs").c_str(), NK_TEXT_LEFT);
+
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_label(ctx, "Cache", NK_TEXT_LEFT);
+      for(size_t i = 0; i < 3; i++){
+        const char* names[] = {"L1", "L2", "LLC"};
+        nk_layout_row_dynamic(ctx, 25, 2);
+        nk_property_int(ctx, (string("#") + names[i] + " KiB:").c_str(), 1, &cache_kib[i], 1 << 20, 1, 1);
+        nk_property_int(ctx, "#Ways:", 1, &cache_ways[i], 64, 1, 1);
+      }
+      nk_layout_row_dynamic(ctx, 25, 1);
+      nk_property_int(ctx, "Line (bytes):", 4, &cache_line, 4096, 4, 1);
+
+      // the simulators belong to the sort threads until the run is over
+      if(!running() && !replaying){
+        for(int i = 0; i < active_lanes; i++){
+          if(active_lanes > 1){
+            nk_layout_row_dynamic(ctx, 25, 1);
+            nk_label(ctx, lanes[i].name, NK_TEXT_LEFT);
+          }
+          for(algo::CacheLevel& level : lanes[i].cache.levels){
+            nk_layout_row_dynamic(ctx, 25, 1);
+            string stats = to_string(level.stats.hits) + " hits, " + to_string(level.stats.misses) + " misses";
+            nk_label(ctx, (level.config.name + ": " + stats).c_str(), NK_TEXT_LEFT);
+          }
+        }
+      }
+
+      if(!running() && replay_pending){
+        replay_pending = false;
+        start_replay();
+      }
+
+      if(replaying){
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_label(ctx, "Playback", NK_TEXT_LEFT);
+
+        nk_layout_row_dynamic(ctx, 25, 2);
+        if(nk_button_label(ctx, playing ? "Pause" : "Play")){
+          if(player.tell() >= recording.events) seek_replay(0);
+          playing = !playing;
+        }
+        if(nk_button_label(ctx, "Rewind"))
+          seek_replay(0);
+
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_size position = player.tell();
+        if(nk_progress(ctx, &position, recording.events, NK_MODIFIABLE))
+          seek_replay(position);
+
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_label(ctx, (string("Event: ") + to_string(player.tell()) + "/" + to_string(recording.events)).c_str(), NK_TEXT_LEFT);
+      }
+
+      if(!running()){
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, trace_path, sizeof(trace_path), nk_filter_default);
+
+        nk_layout_row_dynamic(ctx, 25, 2);
+        if(nk_button_label(ctx, "Save trace") && !recording.save(trace_path))
+          fprintf(stderr, "Failed to save trace to %s\n", trace_path);
+        if(nk_button_label(ctx, "Load trace")){
+          if(recording.load(trace_path))
+            start_replay();
+          else
+            fprintf(stderr, "Failed to load trace from %s\n", trace_path);
         }
       }
-      nk_chart_end(ctx);
     }
     nk_end(ctx);
 
+    for(int i = 0; i < active_lanes; i++){
+      lanes[i].pacer.refill(dt, time_scale);
+      drain_events(lanes[i]);
+    }
+    advance_replay();
+
+    // only reserves the space, the bars go on top once the UI is rendered;
+    // lanes stack in one column, or two once there are more than three
+    struct nk_rect bounds[MAX_LANES];
+    int columns = active_lanes > 3 ? 2 : 1;
+    int rows = (active_lanes + columns - 1) / columns;
+    int lane_width = width_chart / columns, lane_height = height / rows;
+    for(int i = 0; i < active_lanes; i++){
+      bounds[i] = nk_rect(0, 0, 0, 0);
+      int place = replaying ? 0 : finishing_place(i);
+      string name = i ? "Chart " + to_string(i + 1) : "Chart";
+      string title = replaying ? "Replay" : lanes[i].name;
+      if(place) title += " - #" + to_string(place);
+
+      // the winner's title bar stands out
+      if(place == 1){
+        nk_style_push_style_item(ctx, &ctx->style.window.header.normal, nk_style_item_color(color_winner));
+        nk_style_push_style_item(ctx, &ctx->style.window.header.hover, nk_style_item_color(color_winner));
+        nk_style_push_style_item(ctx, &ctx->style.window.header.active, nk_style_item_color(color_winner));
+      }
+      struct nk_rect rect = nk_rect(width_settings+width_border*2 + i % columns * lane_width, i / columns * lane_height, lane_width, lane_height);
+      if(nk_begin_titled(ctx, name.c_str(), title.c_str(), rect, NK_WINDOW_TITLE|NK_WINDOW_BORDER|NK_WINDOW_ROM)){
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, lane_stats(lanes[i]).c_str(), NK_TEXT_LEFT);
+        nk_layout_row_static(ctx, max(lane_height-80, 1), max(lane_width-30, 1), 1);
+        if(!nk_widget(&bounds[i], ctx)) bounds[i] = nk_rect(0, 0, 0, 0);
+      }
+      nk_end(ctx);
+      if(place == 1){
+        for(int n = 0; n < 3; n++) nk_style_pop_style_item(ctx);
+      }
+    }
+
     glfwGetWindowSize(win, &width, &height);
     glViewport(0, 0, width, height);
     glClear(GL_COLOR_BUFFER_BIT);
     glClearColor(0, 0, 0, 0);
     nk_glfw3_render(NK_ANTI_ALIASING_OFF, MAX_VERTEX_BUFFER, MAX_ELEMENT_BUFFER);
+
+    int fb_width, fb_height;
+    glfwGetFramebufferSize(win, &fb_width, &fb_height);
+    float scale_x = width ? (float)fb_width / width : 1;
+    float scale_y = height ? (float)fb_height / height : 1;
+    for(int i = 0; i < active_lanes; i++){
+      int chart_x = bounds[i].x * scale_x, chart_y = (height - bounds[i].y - bounds[i].h) * scale_y;
+      draw_lane(lanes[i], chart_x, chart_y, bounds[i].w * scale_x, bounds[i].h * scale_y);
+    }
     glfwSwapBuffers(win);
   }
 
+  bars.destroy();
   nk_glfw3_shutdown();
   glfwTerminate();
 }
@@ -229,25 +781,34 @@ void render(){
 int main(int argc, char** argv){
   algo::init();
 
-  for(pair<string, algo::IAlgo*> e : algo::algos){
+  for(int i = 1; i < argc; i++){
+    if(string(argv[i]) == "--bench"){
+      int ret = bench::main(argc, argv);
+      algo::deinit();
+      return ret;
+    }
+    if(string(argv[i]) == "--export"){
+      int ret = video::main(argc, argv);
+      algo::deinit();
+      return ret;
+    }
+  }
+
+  for(pair<const string, algo::IAlgo<algo::Array<algo::CallbackTrace<int>>>*>& e : algo::algos<algo::CallbackTrace<int>>){
     char* copy = strdup(e.first.c_str());
     printf("Found algo %s\n", copy);
     algo_vec.push_back(copy);
   }
+  arm_lanes(1);
+
+  for(const pair<string, algo::Generator>& generator : algo::generators())
+    distribution_vec.push_back(generator.first.c_str());
 
   windowname = argv[0];
 
   render();
-
-  while(!threads.empty()){
-    thread* t = threads.front();
-    threads.erase(threads.begin());
-    threads.shrink_to_fit();
-    if(t->joinable()){
-      t->join();
-    }
-    delete t;
-  }
+  jobs.cancel();
+  if(current_run.valid()) current_run.wait();
 
   for(const char* e : algo_vec){
     free(const_cast<char*>(e));
@@ -0,0 +1,103 @@
+#include "perf.h"
+
+#ifdef __linux__
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+namespace algo {
+  void PerfSample::add(const PerfSample& other){
+    for(int i = 0; i < Events; i++){
+      available[i] = available[i] && other.available[i];
+      values[i] += other.values[i];
+    }
+  }
+
+  PerfCounters::PerfCounters(){
+    for(int& fd : fds) fd = -1;
+  }
+
+  PerfCounters::~PerfCounters(){
+    close();
+  }
+
+#ifdef __linux__
+  static int open_event(uint32_t type, uint64_t config){
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  bool PerfCounters::open(){
+    close();
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    fds[PerfSample::Cycles] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[PerfSample::Instructions] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[PerfSample::BranchMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    fds[PerfSample::L1dMisses] = open_event(PERF_TYPE_HW_CACHE, l1d_read_miss);
+    fds[PerfSample::LlcMisses] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+    for(int fd : fds)
+      if(fd >= 0) return true;
+    return false;
+  }
+
+  void PerfCounters::close(){
+    for(int& fd : fds){
+      if(fd >= 0) ::close(fd);
+      fd = -1;
+    }
+  }
+
+  void PerfCounters::start(){
+    for(int fd : fds){
+      if(fd >= 0) ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+
+  void PerfCounters::stop(){
+    for(int fd : fds)
+      if(fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  // scales up for the time an event was multiplexed out
+  PerfSample PerfCounters::read(){
+    PerfSample sample;
+    for(int i = 0; i < PerfSample::Events; i++){
+      uint64_t data[3];
+      if(fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data) || !data[2]) continue;
+      sample.available[i] = true;
+      sample.values[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+    }
+    return sample;
+  }
+#else
+  bool PerfCounters::open(){
+    return false;
+  }
+
+  void PerfCounters::close(){
+  }
+
+  void PerfCounters::start(){
+  }
+
+  void PerfCounters::stop(){
+  }
+
+  PerfSample PerfCounters::read(){
+    return PerfSample();
+  }
+#endif
+}
@@ -0,0 +1,50 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace algo {
+  // Hardware counters read around a run. Each event is opened on its own so
+  // a single unsupported one (common in containers and VMs) only drops that
+  // column; available says which ones counted.
+  struct PerfSample {
+    enum Event { Cycles, Instructions, BranchMisses, L1dMisses, LlcMisses, Events };
+
+    bool available[Events] = {};
+    uint64_t values[Events] = {};
+
+    bool has(Event event) const {
+      return available[event];
+    }
+
+    double ipc() const {
+      return has(Cycles) && has(Instructions) && values[Cycles] ? (double)values[Instructions] / values[Cycles] : 0;
+    }
+
+    void add(const PerfSample& other);
+  };
+
+  // Counts the calling thread and every thread it creates while open, via
+  // perf_event_open. Counts of a created thread only show up in read()
+  // once that thread has exited, so scheduler workers have to be started
+  // after open() and stopped before read(). Counts add up over every
+  // start()/stop() pair in between.
+  class PerfCounters {
+    int fds[PerfSample::Events];
+
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    // false when no event at all could be opened
+    bool open();
+    void close();
+
+    void start();
+    void stop();
+    PerfSample read();
+  };
+}
+
+#endif
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "recording.h"
+
+using namespace std;
+
+namespace algo {
+  static const char magic[8] = {'S', 'O', 'R', 'T', 'T', 'R', 'C', '2'};
+
+  static int64_t unzigzag(uint64_t v){
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+  }
+
+  // false when the varint runs past the end or doesn't fit 64 bits
+  static bool get_varint(const vector<uint8_t>& bytes, size_t& offset, uint64_t& v){
+    v = 0;
+    for(int shift = 0; shift < 64 && offset < bytes.size(); shift += 7){
+      uint8_t b = bytes[offset++];
+      v |= (uint64_t)(b & 0x7f) << shift;
+      if(!(b & 0x80)) return true;
+    }
+    return false;
+  }
+
+  void Recording::begin(const vector<int>& values){
+    initial = values;
+    bytes.clear();
+    keyframes.clear();
+    events = 0;
+    last_index = 0;
+  }
+
+  // Decodes once to lay down keyframes, spaced so their snapshots cost
+  // roughly a byte per event at most. Also the validation of loaded files:
+  // false if an event is cut off, has an unknown kind or points outside the
+  // array.
+  bool Recording::finish(){
+    keyframes.clear();
+    counters = Counters();
+    size_t interval = max<size_t>(1 << 16, initial.size() * sizeof(int));
+
+    Keyframe frame = {0, 0, 0, initial};
+    size_t index = 0;
+    for(size_t event = 0; event < events; event++){
+      if(event % interval == 0){
+        frame.event = event;
+        keyframes.push_back(frame);
+      }
+      uint64_t head, delta;
+      if(!get_varint(bytes, frame.offset, head)) return false;
+      index += unzigzag(head >> 2);
+      if(index >= frame.values.size()) return false;
+      switch(head & 3){
+        case Access<int>::Read: counters.reads++; break;
+        case Access<int>::Compare: counters.comparisons++; break;
+        case Access<int>::Write:
+          counters.writes++;
+          if(!get_varint(bytes, frame.offset, delta)) return false;
+          frame.values[index] = (int)(frame.values[index] + unzigzag(delta));
+          break;
+        default: return false;
+      }
+      frame.last_index = index;
+    }
+    if(keyframes.empty()) keyframes.push_back(frame);
+    return true;
+  }
+
+  bool Recording::save(const string& path) const {
+    FILE* f = fopen(path.c_str(), "wb");
+    if(!f) return false;
+    uint64_t size = initial.size();
+    uint64_t count = events;
+    uint64_t length = bytes.size();
+    bool ok = fwrite(magic, sizeof(magic), 1, f) == 1
+      && fwrite(&size, sizeof(size), 1, f) == 1
+      && fwrite(initial.data(), sizeof(int), size, f) == size
+      && fwrite(&count, sizeof(count), 1, f) == 1
+      && fwrite(&length, sizeof(length), 1, f) == 1
+      && fwrite(bytes.data(), 1, length, f) == length;
+    return fclose(f) == 0 && ok;
+  }
+
+  // Nothing in the file is trusted: sizes are checked against what is left
+  // of it before allocating, and the events are decoded once into a copy
+  // before this recording is replaced, so a bad file leaves it as it was
+  bool Recording::load(const string& path){
+    FILE* f = fopen(path.c_str(), "rb");
+    if(!f) return false;
+    fseek(f, 0, SEEK_END);
+    long end = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint64_t left = end > 0 ? end : 0;
+
+    Recording loaded;
+    char header[8];
+    uint64_t size = 0, count = 0, length = 0;
+    bool ok = fread(header, sizeof(header), 1, f) == 1 && !memcmp(header, magic, sizeof(magic))
+      && fread(&size, sizeof(size), 1, f) == 1
+      && size <= left / sizeof(int);
+    if(ok){
+      loaded.initial.resize(size);
+      ok = fread(loaded.initial.data(), sizeof(int), size, f) == size
+        && fread(&count, sizeof(count), 1, f) == 1
+        && fread(&length, sizeof(length), 1, f) == 1
+        // every event takes at least a byte
+        && length <= left && count <= length;
+    }
+    if(ok){
+      loaded.bytes.resize(length);
+      ok = fread(loaded.bytes.data(), 1, length, f) == length;
+    }
+    fclose(f);
+    if(!ok) return false;
+
+    loaded.events = count;
+    if(!loaded.finish()) return false;
+    initial = move(loaded.initial);
+    bytes = move(loaded.bytes);
+    keyframes = move(loaded.keyframes);
+    counters = loaded.counters;
+    events = loaded.events;
+    last_index = 0;
+    return true;
+  }
+
+  void Player::reset(){
+    values = recording.initial;
+    position = 0;
+    offset = 0;
+    last_index = 0;
+  }
+
+  void Player::seek(size_t event){
+    if(event > recording.events) event = recording.events;
+    const Recording::Keyframe* frame = &recording.keyframes.front();
+    for(const Recording::Keyframe& k : recording.keyframes){
+      if(k.event > event) break;
+      frame = &k;
+    }
+
+    // only rewind to the keyframe when moving backwards or past the next one
+    if(event < position || frame->event > position){
+      values = frame->values;
+      position = frame->event;
+      offset = frame->offset;
+      last_index = frame->last_index;
+    }
+
+    Access<int> access;
+    while(position < event && step(access));
+  }
+
+  bool Player::decode(size_t& offset, Access<int>& access) const {
+    if(position >= recording.events) return false;
+
+    // finish() has checked every event, this only guards against misuse
+    uint64_t head, delta = 0;
+    if(!get_varint(recording.bytes, offset, head)) return false;
+    access.kind = (Access<int>::Kind)(head & 3);
+    if(access.kind > Access<int>::Compare) return false;
+    access.index = last_index + unzigzag(head >> 2);
+    if(access.index >= values.size()) return false;
+    access.old_value = values[access.index];
+    if(access.kind == Access<int>::Write && !get_varint(recording.bytes, offset, delta)) return false;
+    access.value = (int)(access.old_value + unzigzag(delta));
+    return true;
+  }
+
+  bool Player::peek(Access<int>& access) const {
+    size_t next = offset;
+    return decode(next, access);
+  }
+
+  bool Player::step(Access<int>& access){
+    if(!decode(offset, access)) return false;
+    values[access.index] = access.value;
+    last_index = access.index;
+    position++;
+    return true;
+  }
+}
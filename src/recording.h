@@ -0,0 +1,113 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace algo {
+  // Every access of one sort run, delta-encoded. Each event is a varint of
+  // the zigzagged index delta shifted left by two with the low bits holding
+  // the Access kind; writes are followed by a varint of the zigzagged value
+  // delta. Old values are not stored, replay knows them from its own state.
+  class Recording {
+  public:
+    struct Keyframe {
+      size_t event;
+      size_t offset;
+      size_t last_index;
+      std::vector<int> values;
+    };
+
+    std::vector<int> initial;
+    std::vector<uint8_t> bytes;
+    std::vector<Keyframe> keyframes;
+    Counters counters;
+    size_t events = 0;
+
+    void begin(const std::vector<int>& values);
+    bool finish();
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    void read(size_t index){
+      std::lock_guard<SpinLock> guard(lock);
+      put(index, Access<int>::Read);
+    }
+
+    void write(size_t index, int old_value, int value){
+      std::lock_guard<SpinLock> guard(lock);
+      put(index, Access<int>::Write);
+      put_varint(zigzag((int64_t)value - old_value));
+    }
+
+    void compare(){
+      std::lock_guard<SpinLock> guard(lock);
+      put(last_index, Access<int>::Compare);
+    }
+
+  private:
+    size_t last_index = 0;
+    SpinLock lock;
+
+    static uint64_t zigzag(int64_t v){
+      return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+    }
+
+    void put_varint(uint64_t v){
+      while(v >= 0x80){
+        bytes.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+      }
+      bytes.push_back((uint8_t)v);
+    }
+
+    void put(size_t index, uint64_t kind){
+      put_varint(zigzag((int64_t)index - (int64_t)last_index) << 2 | kind);
+      last_index = index;
+      events++;
+    }
+  };
+
+  // Decodes a recording into array states, seeking through keyframes
+  class Player {
+    const Recording& recording;
+    std::vector<int> values;
+    size_t position = 0;
+    size_t offset = 0;
+    size_t last_index = 0;
+
+    bool decode(size_t& offset, Access<int>& access) const;
+
+  public:
+    Player(const Recording& recording) : recording(recording) {}
+
+    void reset();
+    void seek(size_t event);
+    bool peek(Access<int>& access) const;
+    bool step(Access<int>& access);
+
+    size_t tell() const {
+      return position;
+    }
+
+    const std::vector<int>& state() const {
+      return values;
+    }
+  };
+
+  struct RecordingTrace {
+    Recording* recording = nullptr;
+
+    void read(size_t index){ recording->read(index); }
+    void write(size_t index, const int& old_value, const int& value){ recording->write(index, old_value, value); }
+    void compare(){ recording->compare(); }
+    void swap(size_t a, size_t b){}
+  };
+}
+
+#endif
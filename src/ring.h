@@ -0,0 +1,60 @@
+#ifndef RING_H
+#define RING_H
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+
+namespace algo {
+  // Single-producer/single-consumer ring buffer. The producer only writes
+  // tail, the consumer only writes head, so neither side takes a lock.
+  template <typename T> class Ring {
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+  public:
+    // capacity is rounded up to a power of two
+    Ring(size_t capacity){
+      size_t size = 1;
+      while(size < capacity) size <<= 1;
+      slots.resize(size);
+      mask = size - 1;
+    }
+
+    bool push(const T& item){
+      size_t t = tail.load(std::memory_order_relaxed);
+      if(t - head.load(std::memory_order_acquire) == slots.size()) return false;
+      slots[t & mask] = item;
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool pop(T& item){
+      size_t h = head.load(std::memory_order_relaxed);
+      if(h == tail.load(std::memory_order_acquire)) return false;
+      item = slots[h & mask];
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    bool peek(T& item){
+      size_t h = head.load(std::memory_order_relaxed);
+      if(h == tail.load(std::memory_order_acquire)) return false;
+      item = slots[h & mask];
+      return true;
+    }
+
+    // only meaningful on the producer side, head only moves forward
+    bool full() const {
+      return tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire) == slots.size();
+    }
+
+    bool empty() const {
+      return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,161 @@
+#include "scheduler.h"
+
+using namespace std;
+
+namespace algo {
+  Scheduler::Scheduler(){
+  }
+
+  Scheduler::~Scheduler(){
+    stop();
+  }
+
+  void Scheduler::start(unsigned count){
+    if(count < 1) count = 1;
+    if(count > max_workers - 1) count = max_workers - 1;
+    if(count == size()) return;
+    stop();
+
+    stopping = false;
+    for(unsigned i = 0; i < count; i++)
+      queues.push_back(unique_ptr<Queue>(new Queue()));
+    for(unsigned i = 0; i < count; i++)
+      threads.emplace_back(&Scheduler::work, this, i);
+  }
+
+  void Scheduler::stop(){
+    {
+      lock_guard<mutex> lock(idle_mutex);
+      stopping = true;
+    }
+    idle_cv.notify_all();
+    for(thread& t : threads) t.join();
+    threads.clear();
+    queues.clear();
+  }
+
+  void Scheduler::push(Queue& queue, Task* task){
+    {
+      lock_guard<mutex> lock(queue.mutex);
+      queue.tasks.push_back(task);
+    }
+    {
+      lock_guard<mutex> lock(idle_mutex);
+      pending++;
+    }
+    idle_cv.notify_one();
+  }
+
+  Scheduler::Task* Scheduler::pop_back(Queue& queue){
+    lock_guard<mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) return nullptr;
+    Task* task = queue.tasks.back();
+    queue.tasks.pop_back();
+    pending--;
+    return task;
+  }
+
+  Scheduler::Task* Scheduler::pop_front(Queue& queue){
+    lock_guard<mutex> lock(queue.mutex);
+    if(queue.tasks.empty()) return nullptr;
+    Task* task = queue.tasks.front();
+    queue.tasks.pop_front();
+    pending--;
+    return task;
+  }
+
+  // own deque first, then steal round-robin starting after ourselves
+  Scheduler::Task* Scheduler::find(unsigned self){
+    if(Task* task = pop_back(*queues[self])) return task;
+    for(size_t i = 1; i < queues.size(); i++)
+      if(Task* task = pop_front(*queues[(self + i) % queues.size()])) return task;
+    return pop_front(inject);
+  }
+
+  void Scheduler::execute(Task* task){
+    try{
+      task->fn();
+    }catch(...){
+      task->error = current_exception();
+    }
+    task->done.store(true, memory_order_release);
+    {
+      // waiters outside the pool sleep on idle_cv
+      lock_guard<mutex> lock(idle_mutex);
+    }
+    idle_cv.notify_all();
+  }
+
+  void Scheduler::work(unsigned self){
+    worker = self + 1;
+    while(true){
+      if(Task* task = find(self)){
+        execute(task);
+        continue;
+      }
+      unique_lock<mutex> lock(idle_mutex);
+      idle_cv.wait(lock, [this]{ return pending > 0 || stopping; });
+      if(stopping) return;
+    }
+  }
+
+  void Scheduler::fork_join(const function<void()>& a, const function<void()>& b){
+    if(queues.empty()){
+      a();
+      b();
+      return;
+    }
+
+    if(!worker){
+      // not one of ours: run the fork as a root task and wait for it
+      Task root;
+      root.fn = [&]{ fork_join(a, b); };
+      push(inject, &root);
+      unique_lock<mutex> lock(idle_mutex);
+      idle_cv.wait(lock, [&]{ return root.done.load(memory_order_acquire); });
+      if(root.error) rethrow_exception(root.error);
+      return;
+    }
+
+    unsigned self = worker - 1;
+    Task forked;
+    forked.fn = b;
+    push(*queues[self], &forked);
+
+    exception_ptr error;
+    try{
+      a();
+    }catch(...){
+      error = current_exception();
+    }
+
+    // help out until the forked half is done, running it ourselves if
+    // nobody stole it
+    while(!forked.done.load(memory_order_acquire)){
+      if(Task* task = find(self))
+        execute(task);
+      else
+        this_thread::yield();
+    }
+
+    if(error) rethrow_exception(error);
+    if(forked.error) rethrow_exception(forked.error);
+  }
+
+  void Scheduler::parallel_for(size_t begin, size_t end, size_t grain, const function<void(size_t, size_t)>& body){
+    if(end - begin <= grain || size() < 2){
+      body(begin, end);
+      return;
+    }
+    size_t mid = begin + (end - begin) / 2;
+    fork_join(
+      [&]{ parallel_for(begin, mid, grain, body); },
+      [&]{ parallel_for(mid, end, grain, body); }
+    );
+  }
+
+  Scheduler& scheduler(){
+    static Scheduler instance;
+    return instance;
+  }
+}
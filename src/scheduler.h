@@ -0,0 +1,74 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <cstddef>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "trace.h"
+
+namespace algo {
+  // Fork/join scheduler with one deque per worker. Workers push forked
+  // tasks to the back of their own deque and pop from the back, idle
+  // workers steal from the front of someone else's. Threads that are not
+  // workers hand their work in through an inject queue and wait.
+  class Scheduler {
+  public:
+    struct Task {
+      std::function<void()> fn;
+      std::atomic<bool> done{false};
+      std::exception_ptr error;
+    };
+
+    Scheduler();
+    ~Scheduler();
+
+    // (re)starts with the given number of workers, only while idle
+    void start(unsigned threads);
+    void stop();
+
+    unsigned size() const {
+      return queues.size();
+    }
+
+    // Runs a and b, in parallel when a worker is free, rethrowing the first
+    // exception either of them threw
+    void fork_join(const std::function<void()>& a, const std::function<void()>& b);
+
+    // Splits [begin, end) in halves down to grain sized chunks
+    void parallel_for(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task*> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    Queue inject;
+    std::mutex idle_mutex;
+    std::condition_variable idle_cv;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> stopping{false};
+
+    void push(Queue& queue, Task* task);
+    Task* pop_back(Queue& queue);
+    Task* pop_front(Queue& queue);
+    Task* find(unsigned self);
+    void execute(Task* task);
+    void work(unsigned self);
+  };
+
+  // The engine's scheduler, shared by all parallel algorithms
+  Scheduler& scheduler();
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace algo {
+  // Single-producer/single-consumer triple buffer. The producer fills its
+  // back slot and swaps it with the middle one, the consumer swaps the
+  // middle one with its front slot when something new was published.
+  // Neither side ever waits; values the consumer never took are dropped.
+  template <typename T> class TripleBuffer {
+    enum : uint8_t { Index = 3, Fresh = 4 };
+
+    T slots[3];
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t back = 0;
+    alignas(64) uint8_t front = 2;
+
+  public:
+    T& write_buffer(){
+      return slots[back];
+    }
+
+    void publish(){
+      back = middle.exchange(back | Fresh, std::memory_order_acq_rel) & Index;
+    }
+
+    // true when a new value was taken into read_buffer()
+    bool take(){
+      if(!(middle.load(std::memory_order_relaxed) & Fresh)) return false;
+      front = middle.exchange(front, std::memory_order_acq_rel) & Index;
+      return true;
+    }
+
+    const T& read_buffer() const {
+      return slots[front];
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace algo {
+  struct Counters {
+    size_t reads = 0;
+    size_t writes = 0;
+    size_t comparisons = 0;
+    size_t swaps = 0;
+  };
+
+  // Index of the scheduler worker running on this thread, 0 on any other
+  // thread. Tracing state that several workers touch is kept per worker.
+  const unsigned max_workers = 64;
+  inline thread_local unsigned worker = 0;
+
+  // Guards tracing state shared between workers, uncontended it costs two
+  // atomic operations
+  class SpinLock {
+    std::atomic_flag flag = ATOMIC_FLAG_INIT;
+
+  public:
+    void lock(){
+      while(flag.test_and_set(std::memory_order_acquire)) std::this_thread::yield();
+    }
+
+    void unlock(){
+      flag.clear(std::memory_order_release);
+    }
+  };
+
+  // Compact record of a single element access, as published to the renderer.
+  // Snapshot marks where a whole copy of the array was handed to the
+  // renderer (index is its version) and is never recorded. The trace format
+  // keeps the kind in two bits, 3 is unused and rejected on load.
+  template <typename T> struct Access {
+    enum Kind : uint8_t { Read, Write, Compare, Snapshot = 4 };
+    Kind kind;
+    uint8_t worker;
+    uint32_t index;
+    T old_value;
+    T value;
+  };
+
+  // Tracing policies. A TracedArray inherits exactly one of these and calls
+  // it on every element access, so an empty policy costs nothing once inlined.
+  struct NoTrace {
+    void read(size_t index){}
+    template <typename T> void write(size_t index, const T& old_value, const T& value){}
+    void compare(){}
+    void swap(size_t a, size_t b){}
+  };
+
+  // One set of counters per worker so parallel algorithms don't race
+  struct CountingTrace {
+    struct alignas(64) Slot {
+      Counters counters;
+    };
+    Slot slots[max_workers];
+
+    void read(size_t index){ slots[worker].counters.reads++; }
+    template <typename T> void write(size_t index, const T& old_value, const T& value){ slots[worker].counters.writes++; }
+    void compare(){ slots[worker].counters.comparisons++; }
+    void swap(size_t a, size_t b){ slots[worker].counters.swaps++; }
+
+    Counters counters() const {
+      Counters total;
+      for(const Slot& slot : slots){
+        total.reads += slot.counters.reads;
+        total.writes += slot.counters.writes;
+        total.comparisons += slot.counters.comparisons;
+        total.swaps += slot.counters.swaps;
+      }
+      return total;
+    }
+  };
+
+  template <typename T> struct CallbackTrace {
+    std::function<void(size_t)> cb_read;
+    std::function<void(size_t, const T&, const T&)> cb_write;
+    std::function<void()> cb_compare;
+
+    void read(size_t index){ if(cb_read) cb_read(index); }
+    void write(size_t index, const T& old_value, const T& value){ if(cb_write) cb_write(index, old_value, value); }
+    void compare(){ if(cb_compare) cb_compare(); }
+    void swap(size_t a, size_t b){}
+  };
+}
+
+#endif
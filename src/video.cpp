@@ -0,0 +1,265 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "algo.h"
+#include "video.h"
+#include "generators.h"
+#include "recording.h"
+#include "scheduler.h"
+
+using namespace std;
+
+namespace video {
+  struct Options {
+    string algorithm;
+    string distribution = "Uniform random";
+    size_t size = 1000;
+    size_t k = 0;
+    unsigned seed = 1;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    string trace;
+    string output = "-";
+    int width = 640;
+    int height = 360;
+    int fps = 60;
+    double per_frame = 0;
+    double hold = 1;
+  };
+
+  // Same meaning as the live view's touch codes, minus the worker, which
+  // recordings don't keep
+  enum : uint8_t { UNTOUCHED, TOUCHED_READ, TOUCHED_WRITE, Codes };
+
+  static void usage(const char* name){
+    fprintf(stderr,
+      "Usage: %s --export [options]\n"
+      "  --algo NAME         algorithm to record (required unless --trace)\n"
+      "  --trace FILE        replay a saved trace instead of recording a run\n"
+      "  --size N            elements (default 1000)\n"
+      "  --dist D            input distribution (default Uniform random)\n"
+      "  --inversions K      swaps for Nearly sorted (default sqrt(size))\n"
+      "  --seed N            input seed (default 1)\n"
+      "  --threads N         scheduler workers while recording (default all cores)\n"
+      "  --output FILE       Y4M file to write, - for stdout (default -)\n"
+      "  --width N           frame width in pixels (default 640)\n"
+      "  --height N          frame height in pixels (default 360)\n"
+      "  --fps N             frame rate in the stream header (default 60)\n"
+      "  --per-frame X       accesses per frame, below 1 repeats frames (default: run lasts 10s)\n"
+      "  --hold S            seconds to show the sorted result at the end (default 1)\n",
+      name);
+  }
+
+  static bool parse(int argc, char** argv, Options& opts){
+    for(int i = 1; i < argc; i++){
+      string arg = argv[i];
+      bool has_value = i+1 < argc;
+      if(arg == "--export"){
+        continue;
+      }else if(arg == "--algo" && has_value){
+        opts.algorithm = argv[++i];
+      }else if(arg == "--trace" && has_value){
+        opts.trace = argv[++i];
+      }else if(arg == "--size" && has_value){
+        opts.size = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--dist" && has_value){
+        opts.distribution = argv[++i];
+      }else if(arg == "--inversions" && has_value){
+        opts.k = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--seed" && has_value){
+        opts.seed = strtoul(argv[++i], nullptr, 10);
+      }else if(arg == "--threads" && has_value){
+        opts.threads = max(1, atoi(argv[++i]));
+      }else if(arg == "--output" && has_value){
+        opts.output = argv[++i];
+      }else if(arg == "--width" && has_value){
+        opts.width = atoi(argv[++i]);
+      }else if(arg == "--height" && has_value){
+        opts.height = atoi(argv[++i]);
+      }else if(arg == "--fps" && has_value){
+        opts.fps = max(1, atoi(argv[++i]));
+      }else if(arg == "--per-frame" && has_value){
+        opts.per_frame = atof(argv[++i]);
+      }else if(arg == "--hold" && has_value){
+        opts.hold = max(0.0, atof(argv[++i]));
+      }else{
+        usage(argv[0]);
+        return false;
+      }
+    }
+    // heights are compared as 16 bit lanes
+    if(opts.width <= 0 || opts.height <= 0 || opts.height > 8192 || (opts.algorithm.empty() && opts.trace.empty())){
+      usage(argv[0]);
+      return false;
+    }
+    return true;
+  }
+
+  // Sets each pixel of a row to its column's color where the bar reaches
+  // above level, to the background elsewhere
+  static void fill_row(uint8_t* row, const int16_t* heights, const uint8_t* colors, int16_t level, uint8_t background, size_t width){
+    size_t x = 0;
+#ifdef __SSE2__
+    const __m128i levels = _mm_set1_epi16(level);
+    const __m128i fill = _mm_set1_epi8(background);
+    for(; x + 16 <= width; x += 16){
+      __m128i low = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(heights + x)), levels);
+      __m128i high = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*)(heights + x + 8)), levels);
+      __m128i mask = _mm_packs_epi16(low, high);
+      __m128i color = _mm_loadu_si128((const __m128i*)(colors + x));
+      _mm_storeu_si128((__m128i*)(row + x), _mm_or_si128(_mm_and_si128(mask, color), _mm_andnot_si128(mask, fill)));
+    }
+#endif
+    for(; x < width; x++) row[x] = heights[x] > level ? colors[x] : background;
+  }
+
+  // Planar 4:4:4 frame; bars are laid out per pixel column once, then every
+  // row of every plane is a compare and blend against the column heights
+  class Frame {
+    size_t width, height;
+    vector<size_t> begin, end;
+    vector<int16_t> heights;
+    vector<uint8_t> colors[3];
+    vector<uint8_t> planes;
+    uint8_t palette[Codes][3];
+    uint8_t background[3];
+
+    static void yuv(int r, int g, int b, uint8_t* out){
+      out[0] = 16 + (65.481 * r + 128.553 * g + 24.966 * b) / 255;
+      out[1] = 128 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255;
+      out[2] = 128 + (112.0 * r - 93.786 * g - 18.214 * b) / 255;
+    }
+
+  public:
+    Frame(size_t width, size_t height, size_t elements) : width(width), height(height), begin(width), end(width), heights(width), planes(width * height * 3) {
+      for(vector<uint8_t>& plane : colors) plane.resize(width);
+      // the live view's colors at half alpha over black
+      yuv(0, 128, 0, palette[UNTOUCHED]);
+      yuv(0, 0, 128, palette[TOUCHED_READ]);
+      yuv(128, 0, 0, palette[TOUCHED_WRITE]);
+      yuv(0, 0, 0, background);
+
+      // each column covers at least one element; wide bars get a gap
+      for(size_t x = 0; x < width; x++){
+        begin[x] = x * elements / width;
+        end[x] = max(begin[x] + 1, (x + 1) * elements / width);
+      }
+      if(elements * 3 > width) return;
+      for(size_t x = 0; x + 1 < width; x++)
+        if(begin[x + 1] != begin[x]) end[x] = begin[x];
+    }
+
+    void draw(const vector<int>& values, const vector<uint8_t>& touched, int max_value){
+      for(size_t x = 0; x < width; x++){
+        int high = 0;
+        uint8_t code = UNTOUCHED;
+        for(size_t i = begin[x]; i < end[x] && i < values.size(); i++){
+          high = max(high, values[i]);
+          code = max(code, touched[i]);
+        }
+        heights[x] = max_value > 0 ? (int64_t)min(high, max_value) * height / max_value : 0;
+        for(int p = 0; p < 3; p++) colors[p][x] = palette[code][p];
+      }
+      for(int p = 0; p < 3; p++){
+        uint8_t* plane = &planes[p * width * height];
+        for(size_t y = 0; y < height; y++)
+          fill_row(plane + y * width, heights.data(), colors[p].data(), height - 1 - y, background[p], width);
+      }
+    }
+
+    bool write(FILE* out) const {
+      return fputs("FRAME\n", out) >= 0 && fwrite(planes.data(), 1, planes.size(), out) == planes.size();
+    }
+  };
+
+  static bool record(const Options& opts, algo::Recording& recording){
+    if(!algo::algos<algo::RecordingTrace>.count(opts.algorithm)){
+      fprintf(stderr, "Unknown algorithm %s\n", opts.algorithm.c_str());
+      return false;
+    }
+    vector<int> values;
+    if(!algo::generate(opts.distribution, opts.size, opts.k, opts.seed, values)){
+      fprintf(stderr, "Unknown distribution %s\n", opts.distribution.c_str());
+      return false;
+    }
+
+    algo::Array<algo::RecordingTrace> array;
+    array.assign(values);
+    array.recording = &recording;
+    recording.begin(values);
+    algo::scheduler().start(opts.threads);
+    algo::CancellationToken token;
+    algo::algos<algo::RecordingTrace>[opts.algorithm]->run(array, token);
+    recording.finish();
+    return true;
+  }
+
+  int main(int argc, char** argv){
+    Options opts;
+    if(!parse(argc, argv, opts)) return 1;
+
+    algo::Recording recording;
+    if(!opts.trace.empty()){
+      if(!recording.load(opts.trace)){
+        fprintf(stderr, "Failed to load trace from %s\n", opts.trace.c_str());
+        return 1;
+      }
+    }else if(!record(opts, recording)){
+      return 1;
+    }
+
+    FILE* out = opts.output == "-" ? stdout : fopen(opts.output.c_str(), "wb");
+    if(!out){
+      fprintf(stderr, "Failed to open %s\n", opts.output.c_str());
+      return 1;
+    }
+
+    algo::Player player(recording);
+    player.reset();
+    int max_value = 0;
+    for(int value : recording.initial) max_value = max(max_value, value);
+    vector<uint8_t> touched(recording.initial.size(), UNTOUCHED);
+    Frame frame(opts.width, opts.height, recording.initial.size());
+
+    double per_frame = opts.per_frame > 0 ? opts.per_frame : max(1.0, recording.events / (10.0 * opts.fps));
+    fprintf(stderr, "Rendering %zu events at %g per frame\n", recording.events, per_frame);
+    fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", opts.width, opts.height, opts.fps);
+
+    // less than one access per frame carries over, so slow motion repeats frames
+    bool ok = true;
+    size_t frames = 0;
+    double budget = 0;
+    algo::Access<int> access;
+    while(ok && player.tell() < recording.events){
+      fill(touched.begin(), touched.end(), UNTOUCHED);
+      for(budget += per_frame; budget >= 1 && player.step(access); budget--){
+        uint8_t code = access.kind == algo::Access<int>::Write ? TOUCHED_WRITE : access.kind == algo::Access<int>::Read ? TOUCHED_READ : UNTOUCHED;
+        touched[access.index] = max(touched[access.index], code);
+      }
+      frame.draw(player.state(), touched, max_value);
+      ok = frame.write(out);
+      frames++;
+    }
+
+    fill(touched.begin(), touched.end(), UNTOUCHED);
+    frame.draw(player.state(), touched, max_value);
+    for(int i = 0; ok && i < max(1, (int)(opts.hold * opts.fps)); i++, frames++)
+      ok = frame.write(out);
+
+    if(out != stdout) fclose(out);
+    else fflush(out);
+    if(!ok){
+      fprintf(stderr, "Failed to write %s\n", opts.output.c_str());
+      return 1;
+    }
+    fprintf(stderr, "Wrote %zu frames\n", frames);
+    return 0;
+  }
+}
@@ -0,0 +1,10 @@
+#ifndef VIDEO_H
+#define VIDEO_H
+
+namespace video {
+  // Records a run (or loads a saved trace) and renders its replay to a Y4M
+  // stream on the CPU, no GL context needed
+  int main(int argc, char** argv);
+}
+
+#endif